@@ -0,0 +1,206 @@
+// Copyright (C) 2023 Vincent Chambrin
+// This file is part of the 'events' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "event-emitter.h"
+#include "pubsub.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// Allocation counting: every path through the global allocator is counted,
+// so allocs/op below covers listener nodes, closures and container growth.
+
+static std::size_t g_alloc_count = 0;
+
+void* operator new(std::size_t size)
+{
+  ++g_alloc_count;
+
+  if (void* ptr = std::malloc(size))
+  {
+    return ptr;
+  }
+
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+// sink preventing the compiler from optimizing the benchmarked work away
+volatile int g_sink = 0;
+
+/**
+ * \brief measures \a fn and prints ns/op and allocs/op
+ *
+ * The iteration count is calibrated automatically: it is grown until a run
+ * lasts long enough to give a steady-state figure, and only the final run
+ * is reported.
+ */
+template<typename F>
+void benchmark(const char* name, F&& fn)
+{
+  using Clock = std::chrono::steady_clock;
+
+  constexpr std::chrono::milliseconds min_duration{ 20 };
+  constexpr std::size_t max_iterations = 16 * 1024 * 1024;
+
+  std::size_t iterations = 1;
+
+  for (;;)
+  {
+    g_alloc_count = 0;
+
+    const Clock::time_point start = Clock::now();
+
+    for (std::size_t i(0); i < iterations; ++i)
+    {
+      fn();
+    }
+
+    const Clock::duration elapsed = Clock::now() - start;
+
+    if (elapsed >= min_duration || iterations >= max_iterations)
+    {
+      const double ns = std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+      const double allocs = static_cast<double>(g_alloc_count) / static_cast<double>(iterations);
+      std::printf("%-44s %12.1f ns/op %8.2f allocs/op\n", name, ns, allocs);
+      return;
+    }
+
+    iterations *= 4;
+  }
+}
+
+class BenchSignals : public EventEmitter
+{
+public:
+  void valueChanged(int) {}
+  void statusChanged(int) {}
+};
+
+void bench_emit(const char* name, std::size_t listener_count)
+{
+  BenchSignals emitter;
+
+  for (std::size_t i(0); i < listener_count; ++i)
+  {
+    emitter.on(&BenchSignals::valueChanged, [](int n) {
+      g_sink = g_sink + n;
+    });
+  }
+
+  benchmark(name, [&emitter]() {
+    emitter.emit(&BenchSignals::valueChanged, 1);
+  });
+}
+
+void bench_emit_mixed()
+{
+  BenchSignals emitter;
+
+  for (std::size_t i(0); i < 50; ++i)
+  {
+    emitter.on(&BenchSignals::valueChanged, [](int n) {
+      g_sink = g_sink + n;
+    });
+
+    emitter.on(&BenchSignals::statusChanged, [](int n) {
+      g_sink = g_sink - n;
+    });
+  }
+
+  benchmark("emit (2 event types, 50 listeners each)", [&emitter]() {
+    emitter.emit(&BenchSignals::valueChanged, 1);
+    emitter.emit(&BenchSignals::statusChanged, 2);
+  });
+}
+
+void bench_connect_churn()
+{
+  BenchSignals emitter;
+
+  // a resident listener so the churn never leaves the bucket empty
+  emitter.on(&BenchSignals::valueChanged, [](int) {});
+
+  benchmark("on() + removeListener()", [&emitter]() {
+    ConnectionData c = emitter.on(&BenchSignals::valueChanged, [](int) {});
+    emitter.removeListener(c.connection_id);
+  });
+}
+
+void bench_connection_handle()
+{
+  BenchSignals emitter;
+
+  benchmark("ConnectionHandle create/destroy", [&emitter]() {
+    ConnectionHandle handle{ emitter.on(&BenchSignals::valueChanged, [](int) {}) };
+    g_sink = g_sink + handle.connectionId();
+  });
+}
+
+class BenchSubscriber;
+
+class BenchPublisher : public Publisher<BenchSubscriber>
+{
+
+};
+
+class BenchSubscriber : public Subscriber<BenchPublisher>
+{
+public:
+  void tick(int amount)
+  {
+    g_sink = g_sink + amount;
+  }
+};
+
+void bench_notify(const char* name, std::size_t subscriber_count)
+{
+  BenchPublisher pub;
+  std::vector<BenchSubscriber> subs{ subscriber_count };
+
+  for (BenchSubscriber& s : subs)
+  {
+    pub.addSubscriber(&s);
+  }
+
+  benchmark(name, [&pub]() {
+    pub.notify(&BenchSubscriber::tick, 1);
+  });
+
+  for (BenchSubscriber& s : subs)
+  {
+    pub.removeSubscriber(&s);
+  }
+}
+
+int main()
+{
+  std::printf("--- EventEmitter::emit ---\n");
+  bench_emit("emit (1 listener)", 1);
+  bench_emit("emit (100 listeners)", 100);
+  bench_emit("emit (10k listeners)", 10000);
+  bench_emit_mixed();
+
+  std::printf("--- connection churn ---\n");
+  bench_connect_churn();
+  bench_connection_handle();
+
+  std::printf("--- Publisher::notify ---\n");
+  bench_notify("notify (100 subscribers)", 100);
+  bench_notify("notify (10k subscribers)", 10000);
+
+  return 0;
+}
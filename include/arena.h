@@ -0,0 +1,121 @@
+// Copyright (C) 2023 Vincent Chambrin
+// This file is part of the 'events' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef EVENTS_ARENA_H
+#define EVENTS_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * \brief a pooled allocator for small fixed-size objects
+ *
+ * Memory is carved out of large slabs and recycled through per-size-class
+ * free lists, so an allocate/deallocate cycle does not touch the global
+ * allocator once a slot of the right size exists.
+ *
+ * Allocations larger than the biggest size class fall back to operator new.
+ *
+ * Deallocation requires the caller to pass back the size of the allocation;
+ * this avoids storing a per-allocation header.
+ *
+ * The arena releases all its slabs when destroyed; objects allocated from
+ * it must not outlive it.
+ */
+class Arena
+{
+public:
+  /**
+   * \brief constructs an arena
+   * \param slabsize  the size (in bytes) of the slabs requested from the global allocator
+   */
+  explicit Arena(std::size_t slabsize = 4096)
+    : m_slab_size(slabsize)
+    , m_slab_offset(slabsize)
+  {
+  }
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  /**
+   * \brief allocates \a size bytes
+   *
+   * The returned memory is aligned for any object of size \a size that does
+   * not have an extended alignment requirement.
+   */
+  void* allocate(std::size_t size)
+  {
+    const std::size_t c = size_class(size);
+
+    if (c >= NumClasses)
+    {
+      return ::operator new(size);
+    }
+
+    if (FreeNode* node = m_freelists[c])
+    {
+      m_freelists[c] = node->next;
+      return node;
+    }
+
+    const std::size_t slotsize = (c + 1) * Granularity;
+
+    if (m_slab_offset + slotsize > m_slab_size)
+    {
+      m_slabs.push_back(std::make_unique<unsigned char[]>(m_slab_size));
+      m_slab_offset = 0;
+    }
+
+    void* result = m_slabs.back().get() + m_slab_offset;
+    m_slab_offset += slotsize;
+    return result;
+  }
+
+  /**
+   * \brief returns memory previously obtained from allocate()
+   * \param ptr   the pointer returned by allocate()
+   * \param size  the size that was passed to allocate()
+   *
+   * The slot is pushed onto the free list of its size class and will be
+   * reused by a subsequent allocation of a compatible size.
+   */
+  void deallocate(void* ptr, std::size_t size)
+  {
+    const std::size_t c = size_class(size);
+
+    if (c >= NumClasses)
+    {
+      ::operator delete(ptr);
+      return;
+    }
+
+    auto* node = static_cast<FreeNode*>(ptr);
+    node->next = m_freelists[c];
+    m_freelists[c] = node;
+  }
+
+private:
+  struct FreeNode
+  {
+    FreeNode* next;
+  };
+
+  static constexpr std::size_t Granularity = 16;
+  static constexpr std::size_t NumClasses = 16; // slots of 16 to 256 bytes
+
+  static std::size_t size_class(std::size_t size)
+  {
+    return size == 0 ? 0 : (size + Granularity - 1) / Granularity - 1;
+  }
+
+private:
+  std::size_t m_slab_size;
+  std::size_t m_slab_offset;
+  std::vector<std::unique_ptr<unsigned char[]>> m_slabs;
+  FreeNode* m_freelists[NumClasses] = {};
+};
+
+#endif // EVENTS_ARENA_H
@@ -0,0 +1,152 @@
+// Copyright (C) 2023 Vincent Chambrin
+// This file is part of the 'events' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef AWAITABLE_EVENT_H
+#define AWAITABLE_EVENT_H
+
+#include "event-emitter.h"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define EVENTS_HAS_AWAITABLE_EVENTS 1
+#else
+#define EVENTS_HAS_AWAITABLE_EVENTS 0
+#endif
+
+#if EVENTS_HAS_AWAITABLE_EVENTS
+
+#include <coroutine>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+
+namespace details
+{
+
+/**
+ * \brief computes the result type of awaiting an event
+ *
+ * An event with a single parameter awaits to the (decayed) parameter value,
+ * an event with several parameters awaits to a tuple of them, and an event
+ * without parameters awaits to void.
+ */
+template<typename... Args>
+struct await_result
+{
+  using type = std::tuple<std::decay_t<Args>...>;
+};
+
+template<typename A>
+struct await_result<A>
+{
+  using type = std::decay_t<A>;
+};
+
+template<>
+struct await_result<>
+{
+  using type = void;
+};
+
+} // namespace details
+
+/**
+ * \brief awaiter suspending a coroutine until an event is emitted
+ *
+ * The awaiter is itself the listener node: await_suspend() links it into the
+ * emitter's bucket through EventEmitter::addExternalListener(), so awaiting
+ * an event performs no allocation at all — the state lives in the coroutine
+ * frame. The connection is single-shot: the first emission copies the
+ * arguments into the awaiter and resumes the coroutine, and await_resume()
+ * hands them out (see details::await_result for the exact result type).
+ *
+ * If the coroutine is destroyed while suspended, the awaiter disconnects
+ * itself, so no dangling listener is left behind.
+ *
+ * Instances are created by whenEmitted() and must be awaited immediately.
+ */
+template<typename T, typename... Args>
+class EventAwaiter : private details::EventListener<Args...>
+{
+public:
+  EventAwaiter(EventEmitter& emitter, void (T::*event)(Args...))
+    : details::EventListener<Args...>(0)
+    , m_emitter(&emitter)
+    , m_event(event)
+  {
+  }
+
+  EventAwaiter(const EventAwaiter&) = delete;
+  EventAwaiter& operator=(const EventAwaiter&) = delete;
+
+  bool await_ready() const noexcept
+  {
+    return false;
+  }
+
+  void await_suspend(std::coroutine_handle<> handle)
+  {
+    m_handle = handle;
+    m_connection = m_emitter->addExternalListener(m_event, this, /* once= */ true);
+  }
+
+  typename details::await_result<Args...>::type await_resume()
+  {
+    if constexpr (sizeof...(Args) == 0)
+    {
+      return;
+    }
+    else if constexpr (sizeof...(Args) == 1)
+    {
+      return std::move(std::get<0>(*m_result));
+    }
+    else
+    {
+      return std::move(*m_result);
+    }
+  }
+
+protected:
+  void invoke(details::event_arg_t<Args>... args) override
+  {
+    m_result.emplace(args...);
+
+    // the connection is single-shot (once), so the emitter unlinks this node
+    // after invoke() returns; drop the handle first so a destruction of the
+    // awaiter during resume() does not trigger a second removal.
+    m_connection.release();
+    m_handle.resume();
+  }
+
+private:
+  EventEmitter* m_emitter;
+  void (T::*m_event)(Args...);
+  std::coroutine_handle<> m_handle;
+  ConnectionHandle m_connection;
+  std::optional<std::tuple<std::decay_t<Args>...>> m_result;
+};
+
+/**
+ * \brief returns an awaitable suspending the coroutine until \a event is emitted
+ * \param emitter  the emitter
+ * \param event    a pointer to a member function identifying the event
+ *
+ * Typical use, replacing a chain of once() callbacks:
+ *
+ * \code
+ * Task handshake(Connection& c)
+ * {
+ *   std::string greeting = co_await whenEmitted(c, &Connection::messageReceived);
+ *   ...
+ * }
+ * \endcode
+ */
+template<typename T, typename... Args>
+EventAwaiter<T, Args...> whenEmitted(EventEmitter& emitter, void (T::*event)(Args...))
+{
+  return EventAwaiter<T, Args...>(emitter, event);
+}
+
+#endif // EVENTS_HAS_AWAITABLE_EVENTS
+
+#endif // AWAITABLE_EVENT_H
@@ -0,0 +1,188 @@
+// Copyright (C) 2023 Vincent Chambrin
+// This file is part of the 'events' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef EVENTS_CALLBACK_H
+#define EVENTS_CALLBACK_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template<typename Signature, std::size_t Capacity = 3 * sizeof(void*)>
+class Callback;
+
+/**
+ * \brief a small-buffer-optimized alternative to std::function
+ *
+ * Callables no larger than \a Capacity (3 pointers by default) are stored
+ * inline in the object itself; larger ones fall back to a heap allocation.
+ * Unlike std::function, a Callback is move-only, which also allows storing
+ * non-copyable callables.
+ *
+ * Invoking an empty Callback is undefined behavior; use operator bool()
+ * to test for emptiness.
+ */
+template<typename R, typename... Args, std::size_t Capacity>
+class Callback<R(Args...), Capacity>
+{
+public:
+  Callback() = default;
+
+  template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Callback>>>
+  Callback(F&& f)
+  {
+    using Fn = std::decay_t<F>;
+    using Mgr = Manager<Fn, stored_inline<Fn>()>;
+
+    if constexpr (stored_inline<Fn>())
+    {
+      new (&m_storage) Fn(std::forward<F>(f));
+    }
+    else
+    {
+      *reinterpret_cast<Fn**>(&m_storage) = new Fn(std::forward<F>(f));
+    }
+
+    m_invoke = &Mgr::invoke;
+    m_manage = &Mgr::manage;
+  }
+
+  Callback(const Callback&) = delete;
+
+  Callback(Callback&& other)
+    : m_invoke(other.m_invoke)
+    , m_manage(other.m_manage)
+  {
+    if (m_manage)
+    {
+      m_manage(&m_storage, &other.m_storage, Op::Move);
+      other.m_invoke = nullptr;
+      other.m_manage = nullptr;
+    }
+  }
+
+  ~Callback()
+  {
+    reset();
+  }
+
+  Callback& operator=(const Callback&) = delete;
+
+  Callback& operator=(Callback&& other)
+  {
+    if (this != &other)
+    {
+      reset();
+
+      m_invoke = other.m_invoke;
+      m_manage = other.m_manage;
+
+      if (m_manage)
+      {
+        m_manage(&m_storage, &other.m_storage, Op::Move);
+        other.m_invoke = nullptr;
+        other.m_manage = nullptr;
+      }
+    }
+
+    return *this;
+  }
+
+  /**
+   * \brief destroys the stored callable, leaving the Callback empty
+   */
+  void reset()
+  {
+    if (m_manage)
+    {
+      m_manage(&m_storage, nullptr, Op::Destroy);
+      m_invoke = nullptr;
+      m_manage = nullptr;
+    }
+  }
+
+  /**
+   * \brief returns whether a callable is stored
+   */
+  explicit operator bool() const
+  {
+    return m_invoke != nullptr;
+  }
+
+  /**
+   * \brief invokes the stored callable
+   */
+  R operator()(Args... args)
+  {
+    return m_invoke(&m_storage, std::forward<Args>(args)...);
+  }
+
+private:
+  enum class Op { Move, Destroy };
+
+  template<typename Fn>
+  static constexpr bool stored_inline()
+  {
+    return sizeof(Fn) <= Capacity
+        && alignof(Fn) <= alignof(std::max_align_t)
+        && std::is_nothrow_move_constructible_v<Fn>;
+  }
+
+  template<typename Fn, bool Inline>
+  struct Manager;
+
+  template<typename Fn>
+  struct Manager<Fn, true>
+  {
+    static R invoke(void* storage, Args&&... args)
+    {
+      return (*reinterpret_cast<Fn*>(storage))(std::forward<Args>(args)...);
+    }
+
+    static void manage(void* dst, void* src, Op op)
+    {
+      if (op == Op::Move)
+      {
+        auto* f = reinterpret_cast<Fn*>(src);
+        new (dst) Fn(std::move(*f));
+        f->~Fn();
+      }
+      else
+      {
+        reinterpret_cast<Fn*>(dst)->~Fn();
+      }
+    }
+  };
+
+  template<typename Fn>
+  struct Manager<Fn, false>
+  {
+    static R invoke(void* storage, Args&&... args)
+    {
+      return (**reinterpret_cast<Fn**>(storage))(std::forward<Args>(args)...);
+    }
+
+    static void manage(void* dst, void* src, Op op)
+    {
+      if (op == Op::Move)
+      {
+        *reinterpret_cast<Fn**>(dst) = *reinterpret_cast<Fn**>(src);
+      }
+      else
+      {
+        delete *reinterpret_cast<Fn**>(dst);
+      }
+    }
+  };
+
+private:
+  static constexpr std::size_t StorageSize = Capacity < sizeof(void*) ? sizeof(void*) : Capacity;
+
+  alignas(std::max_align_t) unsigned char m_storage[StorageSize];
+  R (*m_invoke)(void*, Args&&...) = nullptr;
+  void (*m_manage)(void*, void*, Op) = nullptr;
+};
+
+#endif // EVENTS_CALLBACK_H
@@ -0,0 +1,195 @@
+// Copyright (C) 2023 Vincent Chambrin
+// This file is part of the 'events' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef EVENTS_CONCURRENT_EVENT_EMITTER_H
+#define EVENTS_CONCURRENT_EVENT_EMITTER_H
+
+#include "event-emitter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+/**
+ * \brief a thread-safe event emitter with a lock-free emit path
+ *
+ * Unlike EventEmitter, this class may be used concurrently from several
+ * threads. The listener table is an immutable snapshot managed through a
+ * shared pointer: emit() atomically loads the current snapshot and never
+ * takes a lock, so emissions from multiple threads proceed in parallel.
+ * on(), once() and removeListener() serialize on a mutex and publish a new
+ * snapshot (copy-on-write), which makes them O(total listeners); the class
+ * is therefore intended for workloads where connections change rarely
+ * compared to emissions.
+ *
+ * A listener registered with once() is invoked exactly once even if the
+ * event is emitted concurrently: the emitting threads race to remove the
+ * connection and only the winner performs the invocation.
+ *
+ * Connections are identified by plain integer ids; ConnectionHandle is not
+ * supported for this emitter.
+ */
+class ConcurrentEventEmitter
+{
+public:
+  ConcurrentEventEmitter()
+    : m_listing(std::make_shared<Listing>())
+  {
+  }
+
+  ConcurrentEventEmitter(const ConcurrentEventEmitter&) = delete;
+  ConcurrentEventEmitter& operator=(const ConcurrentEventEmitter&) = delete;
+
+  /**
+   * \brief add an event listener
+   * \param event     a pointer to a member function identifying the event
+   * \param callback  a function that is called when the event is emitted
+   * \return the id of the connection
+   *
+   * \note \a callback may be invoked concurrently from any thread that emits
+   * the event; it must be thread-safe.
+   */
+  template<typename T, typename F, typename... Args>
+  int on(void (T::*event)(Args...), F&& callback)
+  {
+    return addListener(details::EventKey::make(event), event, std::forward<F>(callback), false);
+  }
+
+  /**
+   * \brief add an event listener that will only be invoked once
+   * \param event     a pointer to a member function identifying the event
+   * \param callback  a function that is called when the event is emitted
+   * \return the id of the connection
+   */
+  template<typename T, typename F, typename... Args>
+  int once(void (T::*event)(Args...), F&& callback)
+  {
+    return addListener(details::EventKey::make(event), event, std::forward<F>(callback), true);
+  }
+
+  /**
+   * \brief fires an event
+   * \param event  a pointer to a member function identifying the event
+   * \param args   event data (template pack)
+   *
+   * This loads the current listener snapshot without locking and invokes the
+   * matching listeners. Listeners added or removed concurrently may or may
+   * not see this emission, depending on which snapshot was loaded.
+   */
+  template<typename T, typename... Params, typename... Args>
+  void emit(void (T::*event)(Params...), Args &&...args)
+  {
+    std::shared_ptr<const Listing> listing = std::atomic_load(&m_listing);
+
+    auto bucket_it = listing->buckets.find(details::EventKey::make(event));
+
+    if (bucket_it == listing->buckets.end())
+    {
+      return;
+    }
+
+    for (const Entry& entry : bucket_it->second)
+    {
+      if (entry.once)
+      {
+        // the threads emitting this event race on the removal; only the
+        // winner invokes the listener, guaranteeing a single invocation.
+        if (!removeListener(entry.id))
+        {
+          continue;
+        }
+      }
+
+      auto* listener = static_cast<details::EventListener<Params...>*>(entry.listener.get());
+      listener->invoke(std::forward<Args>(args)...);
+    }
+  }
+
+  /**
+   * \brief removes a listener previously registered using on() or once()
+   * \param connection_id  the id of the connection
+   * \return whether a connection was actually removed
+   */
+  bool removeListener(int connection_id)
+  {
+    std::lock_guard<std::mutex> lock(m_write_mutex);
+
+    auto listing = std::make_shared<Listing>(*std::atomic_load(&m_listing));
+
+    for (auto& bucket : listing->buckets)
+    {
+      auto it = std::find_if(bucket.second.begin(), bucket.second.end(), [connection_id](const Entry& e)
+                             { return e.id == connection_id; });
+
+      if (it != bucket.second.end())
+      {
+        bucket.second.erase(it);
+
+        if (bucket.second.empty())
+        {
+          listing->buckets.erase(bucket.first);
+        }
+
+        std::atomic_store(&m_listing, std::shared_ptr<const Listing>(std::move(listing)));
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+private:
+  /**
+   * \brief an entry of the listener table
+   *
+   * Listeners are shared pointers so that a snapshot loaded by an emitting
+   * thread keeps its listeners alive even if they are removed concurrently.
+   */
+  struct Entry
+  {
+    int id = 0;
+    bool once = false;
+    std::shared_ptr<details::AbstractEventListener> listener;
+  };
+
+  struct Listing
+  {
+    std::unordered_map<details::EventKey, std::vector<Entry>, details::EventKeyHash> buckets;
+  };
+
+  template<typename T, typename F, typename... Args>
+  int addListener(const details::EventKey& key, void (T::*event)(Args...), F&& callback, bool once)
+  {
+    (void) event;
+
+    std::lock_guard<std::mutex> lock(m_write_mutex);
+
+    const int id = ++m_id_generator;
+
+    Entry entry;
+    entry.id = id;
+    entry.once = once;
+    entry.listener = std::make_shared<details::MemberFunctionEventListener<std::decay_t<F>, Args...>>(id, std::forward<F>(callback));
+
+    auto listing = std::make_shared<Listing>(*std::atomic_load(&m_listing));
+    listing->buckets[key].push_back(std::move(entry));
+    std::atomic_store(&m_listing, std::shared_ptr<const Listing>(std::move(listing)));
+
+    return id;
+  }
+
+private:
+  /**
+   * \brief the current listener snapshot
+   *
+   * Read with std::atomic_load on the emit path, replaced wholesale (under
+   * m_write_mutex) by the mutating operations.
+   */
+  std::shared_ptr<const Listing> m_listing;
+
+  std::mutex m_write_mutex;
+  int m_id_generator = 0;
+};
+
+#endif // EVENTS_CONCURRENT_EVENT_EMITTER_H
@@ -0,0 +1,182 @@
+// Copyright (C) 2023 Vincent Chambrin
+// This file is part of the 'events' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef EVENTS_EVENT_BUS_H
+#define EVENTS_EVENT_BUS_H
+
+#include "event-emitter.h"
+
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * \brief a sharded, many-to-many event bus
+ *
+ * An EventBus decouples producers from consumers: instead of wiring every
+ * emitter to every interested object, producers publish() to the bus and
+ * consumers subscribe() to it, collapsing an M x N connection mesh into a
+ * single structure. Topics are keyed exactly like EventEmitter events, by a
+ * pointer to a member function.
+ *
+ * Internally the bus is an array of shards - one per core by default, each
+ * padded to its own cache line - and a topic is assigned to a shard by
+ * hashing its key. Every shard holds a plain EventEmitter guarded by a
+ * mutex, so the full listener machinery (priorities, once(), conflation
+ * through the emitter) is available, and publishes to topics living in
+ * different shards never contend.
+ *
+ * subscribe() returns the usual ConnectionData, pointing at the shard's
+ * emitter, so connections can be managed through ConnectionHandle and
+ * ConnectionList like any other. Note however that a ConnectionHandle
+ * disconnects without taking the shard mutex; to drop a subscription while
+ * other threads may be publishing, use unsubscribe().
+ */
+class EventBus
+{
+public:
+  /**
+   * \brief constructs a bus with the given number of shards
+   * \param shard_count  the number of shards, or 0 for one per core
+   *
+   * The shard count is rounded up to a power of two so that assigning a
+   * topic to a shard is a mask of its hash.
+   */
+  explicit EventBus(std::size_t shard_count = 0)
+  {
+    if (shard_count == 0)
+    {
+      shard_count = std::thread::hardware_concurrency();
+
+      if (shard_count == 0)
+      {
+        shard_count = 1;
+      }
+    }
+
+    m_shard_count = 1;
+
+    while (m_shard_count < shard_count)
+    {
+      m_shard_count <<= 1;
+    }
+
+    m_shards = std::make_unique<Shard[]>(m_shard_count);
+  }
+
+  EventBus(const EventBus&) = delete;
+  EventBus& operator=(const EventBus&) = delete;
+
+  /**
+   * \brief returns the process-wide bus
+   */
+  static EventBus& global()
+  {
+    static EventBus bus;
+    return bus;
+  }
+
+  /**
+   * \brief returns the number of shards
+   */
+  std::size_t shardCount() const
+  {
+    return m_shard_count;
+  }
+
+  /**
+   * \brief subscribes a callback to a topic
+   * \param event     a pointer to a member function identifying the topic
+   * \param callback  a function that is called when the topic is published
+   * \param priority  priority tier of the listener (lower tiers run first)
+   *
+   * \note \a callback is invoked from whichever thread publishes the topic,
+   * with the owning shard's mutex held; it must not publish to the bus.
+   */
+  template<typename T, typename F, typename... Args>
+  ConnectionData subscribe(void (T::*event)(Args...), F&& callback, int priority = 0)
+  {
+    Shard& shard = shardFor(details::EventKey::make(event));
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.emitter.on(event, std::forward<F>(callback), priority);
+  }
+
+  /**
+   * \brief subscribes a callback that will only be invoked once
+   * \param event     a pointer to a member function identifying the topic
+   * \param callback  a function that is called when the topic is published
+   */
+  template<typename T, typename F, typename... Args>
+  ConnectionData subscribeOnce(void (T::*event)(Args...), F&& callback)
+  {
+    Shard& shard = shardFor(details::EventKey::make(event));
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.emitter.once(event, std::forward<F>(callback));
+  }
+
+  /**
+   * \brief removes a subscription
+   * \param connection  the connection returned by subscribe()
+   * \return whether a subscription was actually removed
+   *
+   * Unlike ConnectionHandle::disconnect(), this takes the owning shard's
+   * mutex and is therefore safe against concurrent publishes.
+   */
+  bool unsubscribe(const ConnectionData& connection)
+  {
+    for (std::size_t i = 0; i < m_shard_count; ++i)
+    {
+      Shard& shard = m_shards[i];
+
+      if (&shard.emitter == connection.emitter)
+      {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.emitter.removeListener(connection.connection_id);
+      }
+    }
+
+    return false;
+  }
+
+  /**
+   * \brief publishes a topic
+   * \param event  a pointer to a member function identifying the topic
+   * \param args   event data (template pack)
+   *
+   * Only the shard owning the topic is locked for the duration of the
+   * dispatch; publishes to topics assigned to other shards proceed in
+   * parallel.
+   */
+  template<typename T, typename... Params, typename... Args>
+  void publish(void (T::*event)(Params...), Args&&... args)
+  {
+    Shard& shard = shardFor(details::EventKey::make(event));
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.emitter.emit(event, std::forward<Args>(args)...);
+  }
+
+private:
+  /**
+   * \brief a shard of the topic index
+   *
+   * Shards are padded to a cache line so that publishers working on
+   * different shards do not falsely share one.
+   */
+  struct alignas(64) Shard
+  {
+    std::mutex mutex;
+    EventEmitter emitter;
+  };
+
+  Shard& shardFor(const details::EventKey& key)
+  {
+    return m_shards[details::EventKeyHash()(key) & (m_shard_count - 1)];
+  }
+
+private:
+  std::unique_ptr<Shard[]> m_shards;
+  std::size_t m_shard_count = 0;
+};
+
+#endif // EVENTS_EVENT_BUS_H
@@ -5,19 +5,158 @@
 #ifndef EVENT_EMITTER_H
 #define EVENT_EMITTER_H
 
+#include "arena.h"
+#include "callback.h"
+#include "instrumentation.h"
+#include "thread-pool.h"
 #include "utils.h"
 
-#include <algorithm>
-#include <any>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <string>
 #include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace details
 {
-  class AbstractEventListener 
+  /**
+   * \brief type-erased key identifying an event
+   *
+   * An event is identified by a pointer to a member function.
+   * Such pointers do not have a unique type (it depends on the class and the
+   * parameter list) so this class stores the raw bytes of the pointer, which
+   * makes it usable as the key of an associative container regardless of the
+   * original pointer type.
+   */
+  class EventKey
+  {
+  public:
+    EventKey() = default;
+
+    template<typename MemFnPtr>
+    static EventKey make(MemFnPtr memfn)
+    {
+      static_assert(std::is_member_function_pointer<MemFnPtr>::value);
+      static_assert(sizeof(MemFnPtr) <= MaxSize, "unsupported member function pointer size");
+
+      EventKey k;
+      std::memcpy(k.m_data, &memfn, sizeof(MemFnPtr));
+      k.m_size = sizeof(MemFnPtr);
+      return k;
+    }
+
+    bool operator==(const EventKey& other) const
+    {
+      return m_size == other.m_size && std::memcmp(m_data, other.m_data, m_size) == 0;
+    }
+
+    bool operator!=(const EventKey& other) const
+    {
+      return !(*this == other);
+    }
+
+    /**
+     * \brief computes a hash of the key (FNV-1a over the pointer bytes)
+     */
+    std::size_t hash() const
+    {
+      std::size_t h = 14695981039346656037ull;
+
+      for (std::size_t i(0); i < m_size; ++i)
+      {
+        h ^= m_data[i];
+        h *= 1099511628211ull;
+      }
+
+      return h;
+    }
+
+  private:
+    static constexpr std::size_t MaxSize = 4 * sizeof(void*);
+    unsigned char m_data[MaxSize] = {};
+    std::size_t m_size = 0;
+  };
+
+  struct EventKeyHash
+  {
+    std::size_t operator()(const EventKey& key) const
+    {
+      return key.hash();
+    }
+  };
+
+  template<typename T>
+  struct is_tuple : std::false_type {};
+
+  template<typename... Ts>
+  struct is_tuple<std::tuple<Ts...>> : std::true_type {};
+
+  /**
+   * \brief the type used to pass an event argument to a listener
+   *
+   * Arguments are borrowed: a listener receives a (const) reference to the
+   * argument owned by the emit call, never its own copy. Parameters that are
+   * already references are passed through unchanged.
+   */
+  template<typename Param>
+  using event_arg_t = std::conditional_t<std::is_reference_v<Param>, Param, const Param&>;
+
+  /**
+   * \brief the type of an element of the argument frame built by emit()
+   *
+   * If the caller's argument already has the type of the event parameter, the
+   * frame merely references it; otherwise the parameter value is materialized
+   * in the frame, once, regardless of the number of listeners.
+   */
+  template<typename Param, typename Arg>
+  using frame_element_t = std::conditional_t<
+      std::is_same_v<std::decay_t<Param>, std::decay_t<Arg>>,
+      Arg&&,
+      std::decay_t<Param>>;
+
+  /**
+   * \brief compile-time dispatch policy
+   *
+   * By default, listener invocation is guarded: exceptions thrown by a
+   * callback are caught and swallowed so that one faulty listener cannot
+   * abort the dispatch loop. Builds that can guarantee that no slot throws
+   * may define EVENTS_NOEXCEPT_SLOTS (see the option in CMakeLists.txt) to
+   * compile the guard out and get straight-line calls.
+   */
+#if defined(EVENTS_NOEXCEPT_SLOTS)
+  constexpr bool guarded_dispatch = false;
+#else
+  constexpr bool guarded_dispatch = true;
+#endif
+
+  /**
+   * \brief invokes a listener callback according to the dispatch policy
+   */
+  template<typename F, typename... Args>
+  void invoke_callback(F& callback, Args&&... args)
+  {
+    if constexpr (guarded_dispatch)
+    {
+      try {
+        invoke_relaxed(callback, std::forward<Args>(args)...);
+      } catch (...) {
+      }
+    }
+    else
+    {
+      invoke_relaxed(callback, std::forward<Args>(args)...);
+    }
+  }
+
+  class AbstractEventListener
   {
   public:
     explicit AbstractEventListener(int i)
@@ -29,282 +168,1709 @@ namespace details
     AbstractEventListener(const AbstractEventListener&) = delete;
     virtual ~AbstractEventListener() {}
 
-    virtual bool matches(const std::any& signal) const = 0;
-    
+    /**
+     * \brief delivers the pending emission of a conflating listener
+     * \return whether a pending emission was delivered
+     *
+     * This is a no-op for regular listeners; see ConflatingEventListener.
+     */
+    virtual bool flush() { return false; }
+
     int id;
     bool once_flag = false;
+
+    /**
+     * \brief priority tier of the listener (lower tiers are invoked first)
+     */
+    int priority = 0;
+
+    /**
+     * \brief arena from which this listener was allocated, or nullptr
+     *
+     * Together with \a alloc_size, this allows the deleter to return the
+     * node to its arena without knowing its dynamic type.
+     */
+    Arena* arena = nullptr;
+    std::uint32_t alloc_size = 0;
+  };
+
+  /**
+   * \brief deleter for listener nodes
+   *
+   * Nodes are either heap-allocated (regular delete) or allocated from an
+   * arena, in which case the destructor is invoked manually and the memory
+   * is returned to the arena.
+   */
+  struct ListenerDeleter
+  {
+    void operator()(AbstractEventListener* listener) const
+    {
+      if (Arena* arena = listener->arena)
+      {
+        const std::size_t size = listener->alloc_size;
+        listener->~AbstractEventListener();
+        arena->deallocate(listener, size);
+      }
+      else
+      {
+        delete listener;
+      }
+    }
+  };
+
+  template<typename... Args>
+  class EventListener : public AbstractEventListener
+  {
+  public:
+    using AbstractEventListener::AbstractEventListener;
+    virtual void invoke(event_arg_t<Args>... args) = 0;
+  };
+
+  template<typename...Args>
+  class FreeFunctionEventListener : public EventListener<Args...>
+  {
+  public:
+    FreeFunctionEventListener(int i, Callback<void(Args...)> callback)
+      : EventListener<Args...>(i)
+      , m_callback(std::move(callback))
+    {
+    }
+    FreeFunctionEventListener(const FreeFunctionEventListener&) = delete;
+    FreeFunctionEventListener& operator=(const FreeFunctionEventListener&) = delete;
+    ~FreeFunctionEventListener(){}
+
+    void invoke(event_arg_t<Args>... args) override
+    {
+      invoke_callback(m_callback, std::forward<event_arg_t<Args>>(args)...);
+    }
+
+  private:
+    Callback<void(Args...)> m_callback;
+  };
+
+  template<typename Callback, typename...Args>
+  class MemberFunctionEventListener : public EventListener<Args...>
+  {
+  public:
+    MemberFunctionEventListener(int i, Callback callback)
+      : EventListener<Args...>(i)
+      , m_callback(std::move(callback))
+    {
+    }
+    MemberFunctionEventListener(const MemberFunctionEventListener&) = delete;
+    MemberFunctionEventListener& operator=(const MemberFunctionEventListener&) = delete;
+    ~MemberFunctionEventListener(){}
+
+    void invoke(event_arg_t<Args>... args) override
+    {
+      invoke_callback(m_callback, std::forward<event_arg_t<Args>>(args)...);
+    }
+
+  private:
+    Callback m_callback;
+  };
+
+  /**
+   * \brief a listener that coalesces emissions into a single pending slot
+   *
+   * Instead of invoking the callback, each emission overwrites the pending
+   * argument pack; the callback is only invoked - with the latest values -
+   * when the emitter flushes its conflated listeners. Memory usage is thus
+   * bounded to one argument pack per listener no matter the emission rate.
+   */
+  template<typename Callback, typename...Args>
+  class ConflatingEventListener : public EventListener<Args...>
+  {
+  public:
+    ConflatingEventListener(int i, Callback callback)
+      : EventListener<Args...>(i)
+      , m_callback(std::move(callback))
+    {
+    }
+    ConflatingEventListener(const ConflatingEventListener&) = delete;
+    ConflatingEventListener& operator=(const ConflatingEventListener&) = delete;
+    ~ConflatingEventListener(){}
+
+    void invoke(event_arg_t<Args>... args) override
+    {
+      m_latest.emplace(args...);
+    }
+
+    bool flush() override
+    {
+      if (!m_latest.has_value())
+      {
+        return false;
+      }
+
+      std::tuple<std::decay_t<Args>...> latest = std::move(*m_latest);
+      m_latest.reset();
+
+      std::apply([this](auto&... unpacked) {
+        invoke_callback(m_callback, unpacked...);
+      }, latest);
+
+      return true;
+    }
+
+  private:
+    Callback m_callback;
+    std::optional<std::tuple<std::decay_t<Args>...>> m_latest;
+  };
+
+  /**
+   * \brief a listener whose callback is guarded by a filter predicate
+   *
+   * The filter is evaluated inside the dispatch loop, before the callback:
+   * when it returns false the emission is discarded for this listener at the
+   * cost of the predicate alone. Like the callback, the filter may declare
+   * fewer parameters than the event.
+   */
+  template<typename Filter, typename Callback, typename... Args>
+  class FilteredEventListener : public EventListener<Args...>
+  {
+  public:
+    FilteredEventListener(int i, Filter filter, Callback callback)
+      : EventListener<Args...>(i)
+      , m_filter(std::move(filter))
+      , m_callback(std::move(callback))
+    {
+    }
+    FilteredEventListener(const FilteredEventListener&) = delete;
+    FilteredEventListener& operator=(const FilteredEventListener&) = delete;
+    ~FilteredEventListener(){}
+
+    void invoke(event_arg_t<Args>... args) override
+    {
+      if (!invoke_relaxed_r(m_filter, args...))
+      {
+        return;
+      }
+
+      invoke_callback(m_callback, std::forward<event_arg_t<Args>>(args)...);
+    }
+
+  private:
+    Filter m_filter;
+    Callback m_callback;
+  };
+
+  /**
+   * \brief a listener keyed on the first event argument
+   *
+   * This is the specialization of FilteredEventListener for the ubiquitous
+   * "if (id != my_id) return;" pattern: the filter is a single equality
+   * compare between the first argument and a stored key, with no predicate
+   * object to call through.
+   */
+  template<typename Callback, typename Key, typename First, typename... Rest>
+  class KeyedEventListener : public EventListener<First, Rest...>
+  {
+  public:
+    KeyedEventListener(int i, Key key, Callback callback)
+      : EventListener<First, Rest...>(i)
+      , m_key(std::move(key))
+      , m_callback(std::move(callback))
+    {
+    }
+    KeyedEventListener(const KeyedEventListener&) = delete;
+    KeyedEventListener& operator=(const KeyedEventListener&) = delete;
+    ~KeyedEventListener(){}
+
+    void invoke(event_arg_t<First> first, event_arg_t<Rest>... rest) override
+    {
+      if (!(first == m_key))
+      {
+        return;
+      }
+
+      invoke_callback(m_callback, std::forward<event_arg_t<First>>(first), std::forward<event_arg_t<Rest>>(rest)...);
+    }
+
+  private:
+    Key m_key;
+    Callback m_callback;
+  };
+
+} // namespace details
+
+class EventEmitter;
+
+namespace details
+{
+  /**
+   * \brief process-wide registry of the live EventEmitter instances
+   *
+   * Each emitter acquires a slot in the registry when constructed and
+   * releases it when destroyed; the slot's generation counter is bumped on
+   * release. A ConnectionHandle stores the (index, generation) token of its
+   * emitter, so testing whether the emitter is still alive is a load and
+   * compare - no shared control block.
+   *
+   * Slots are recycled through a free list, so constructing an emitter is
+   * allocation-free once the registry has reached its high-water mark.
+   *
+   * The registry is a process-wide singleton and emitters may be constructed,
+   * destroyed and validated from different threads, so every operation takes
+   * the registry mutex.
+   */
+  class EmitterRegistry
+  {
+  public:
+    /**
+     * \brief token identifying a registry slot at a point in time
+     */
+    struct Token
+    {
+      int index = -1;
+      std::uint32_t generation = 0;
+    };
+
+    static EmitterRegistry& instance()
+    {
+      static EmitterRegistry registry;
+      return registry;
+    }
+
+    Token acquire(EventEmitter* emitter)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+
+      int index;
+
+      if (m_free != -1)
+      {
+        index = m_free;
+        m_free = m_entries[index].next_free;
+        m_entries[index].next_free = -1;
+      }
+      else
+      {
+        m_entries.emplace_back();
+        index = static_cast<int>(m_entries.size()) - 1;
+      }
+
+      m_entries[index].emitter = emitter;
+      return {index, m_entries[index].generation};
+    }
+
+    void release(const Token& token)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+
+      Entry& entry = m_entries[token.index];
+      entry.emitter = nullptr;
+      ++entry.generation;
+      entry.next_free = m_free;
+      m_free = token.index;
+    }
+
+    /**
+     * \brief returns whether the emitter identified by \a token is still alive
+     */
+    bool isAlive(const Token& token) const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+
+      return token.index >= 0
+          && token.index < static_cast<int>(m_entries.size())
+          && m_entries[token.index].generation == token.generation
+          && m_entries[token.index].emitter != nullptr;
+    }
+
+  private:
+    struct Entry
+    {
+      EventEmitter* emitter = nullptr;
+      std::uint32_t generation = 0;
+      int next_free = -1;
+    };
+
+    mutable std::mutex m_mutex;
+    std::vector<Entry> m_entries;
+    int m_free = -1;
+  };
+
+} // namespace details
+
+namespace details
+{
+  /**
+   * \brief registry interning event names into dense integer ids
+   *
+   * Ids are allocated in registration order, so they index directly into the
+   * per-emitter array of named buckets.
+   */
+  class EventNameRegistry
+  {
+  public:
+    static EventNameRegistry& instance()
+    {
+      static EventNameRegistry registry;
+      return registry;
+    }
+
+    int intern(const std::string& name)
+    {
+      auto result = m_ids.emplace(name, static_cast<int>(m_ids.size()));
+      return result.first->second;
+    }
+
+  private:
+    std::unordered_map<std::string, int> m_ids;
+  };
+
+} // namespace details
+
+/**
+ * \brief an interned event name
+ *
+ * Named events complement the member-function-pointer events for uses where
+ * pointer identity is fragile — typically events crossing module (DSO)
+ * boundaries, where identical-code folding can merge distinct functions.
+ *
+ * The name is hashed exactly once, at construction, into a small integer id;
+ * emitting through an EventName is then an array lookup. Construct EventName
+ * objects once (static or member) rather than from a string on every emit.
+ */
+class EventName
+{
+public:
+  EventName(const char* name)
+    : m_id(details::EventNameRegistry::instance().intern(name))
+  {
+  }
+
+  EventName(const std::string& name)
+    : m_id(details::EventNameRegistry::instance().intern(name))
+  {
+  }
+
+  /**
+   * \brief returns the interned id of the name
+   */
+  int id() const
+  {
+    return m_id;
+  }
+
+  bool operator==(const EventName& other) const
+  {
+    return m_id == other.m_id;
+  }
+
+  bool operator!=(const EventName& other) const
+  {
+    return m_id != other.m_id;
+  }
+
+private:
+  int m_id;
+};
+
+/**
+ * \brief POD struct containing information about a connection
+ */
+struct ConnectionData
+{
+  /**
+   * \brief pointer to the EventEmitter
+   */
+  EventEmitter* emitter = nullptr;
+
+  /**
+   * \brief id of the connection
+   */
+  int connection_id = 0;
+};
+
+/**
+ * \brief a class providing a mean to emit events that can be listened to
+ *
+ * Events are emitted using the emit() member function.
+ * No prior registration of events is necessary.
+ * Any EventEmitter can emit any type of events.
+ * Events are identified by a pointer to a member function.
+ *
+ * Registering a listener is done by calling on() or once().
+ * A ConnectionHandle can be constructed from the return value of these functions
+ * and can be used to manage the lifetime of the connection.
+ */
+class EventEmitter
+{
+public:
+  /**
+   * \brief constructs an event emitter
+   *
+   * The emitter registers itself with the EmitterRegistry; this does not
+   * allocate once the registry's free list is warm.
+   */
+  EventEmitter()
+  {
+    m_lifetoken = details::EmitterRegistry::instance().acquire(this);
+  }
+
+  ~EventEmitter()
+  {
+    // listener nodes owned by the caller (see addExternalListener()) must not
+    // be destroyed with the slot-map; they may even be dangling by now.
+    for (Slot& slot : m_slots)
+    {
+      if (slot.external)
+      {
+        slot.listener.release();
+      }
+    }
+
+    details::EmitterRegistry::instance().release(m_lifetoken);
+  }
+
+  EventEmitter(const EventEmitter&) = delete;
+  EventEmitter& operator=(const EventEmitter&) = delete;
+
+  /**
+   * \brief add an event listener
+   * \param event     a pointer to a member function identifying the event
+   * \param callback  a function that is called when the event is emitted
+   *
+   * The parameter list of the callback must match the one of the event.
+   *
+   * The new listener is added at the end of its priority tier, meaning that it
+   * will be called after all other listeners to \a event previously registered
+   * with the same (or a lower) priority value. Listeners of lower tiers are
+   * always invoked first; the ordering is maintained at registration time, so
+   * emit() walks the listeners in priority order with no per-emit sorting.
+   *
+   * \note \a callback can be any callable object that can be stored in a std::function.
+   */
+  template<typename T, typename F, typename... Args>
+  ConnectionData on(void (T::*event)(Args...), F&& callback, int priority = 0)
+  {
+    return addListener(details::EventKey::make(event), event, std::forward<F>(callback), false, priority);
+  }
+
+  /**
+   * \brief add an event listener (compile-time event variant)
+   * \tparam Event    a pointer to a member function identifying the event
+   * \param callback  a function that is called when the event is emitted
+   * \param priority  priority tier of the listener (lower tiers run first)
+   *
+   * This behaves like on(event, callback) but takes the event as a non-type
+   * template parameter: the event key is computed once per instantiation of
+   * this function instead of once per call.
+   */
+  template<auto Event, typename F>
+  ConnectionData on(F&& callback, int priority = 0)
+  {
+    static const details::EventKey key = details::EventKey::make(Event);
+    return addListener(key, Event, std::forward<F>(callback), false, priority);
+  }
+
+  /**
+   * \brief add an event listener that will only be invoked once
+   * \param event     a pointer to a member function identifying the event
+   * \param callback  a function that is called when the event is emitted
+   *
+   * This is the same as on(), except that the listener will be automatically removed after
+   * its first invokation (if it ever happens).
+   *
+   * Consumption is deferred like any mid-emit removal: the fired listener is
+   * tombstoned and its slot is recycled through the free list once the
+   * outermost emit returns, so draining a burst of single-shot listeners is
+   * linear in their number (no container elements are shifted).
+   */
+  template<typename T, typename F, typename... Args>
+  ConnectionData once(void (T::*event)(Args...), F &&callback)
+  {
+    return addListener(details::EventKey::make(event), event, std::forward<F>(callback), true);
+  }
+
+  /**
+   * \brief add a single-shot event listener (compile-time event variant)
+   * \tparam Event    a pointer to a member function identifying the event
+   * \param callback  a function that is called when the event is emitted
+   *
+   * \sa once(), on<Event>().
+   */
+  template<auto Event, typename F>
+  ConnectionData once(F&& callback)
+  {
+    static const details::EventKey key = details::EventKey::make(Event);
+    return addListener(key, Event, std::forward<F>(callback), true);
+  }
+
+  /**
+   * \brief add an event listener guarded by a filter predicate
+   * \param event     a pointer to a member function identifying the event
+   * \param filter    a predicate invoked with the event arguments
+   * \param callback  a function that is called when the filter passes
+   * \param priority  priority tier of the listener (lower tiers run first)
+   *
+   * The filter is stored alongside the callback in the listener node and is
+   * evaluated by emit() before the callback, so emissions that the listener
+   * does not care about are discarded at the cost of the predicate alone.
+   * Like the callback, the filter may declare fewer parameters than the
+   * event.
+   *
+   * For the common case of an equality filter on the first argument, prefer
+   * onKeyed(), which reduces the check to a single compare.
+   */
+  template<typename T, typename Filter, typename F, typename... Args>
+  ConnectionData onFiltered(void (T::*event)(Args...), Filter&& filter, F&& callback, int priority = 0)
+  {
+    return addListenerNode<details::FilteredEventListener<std::decay_t<Filter>, std::decay_t<F>, Args...>>(
+      m_buckets[details::EventKey::make(event)], false, priority,
+      std::forward<Filter>(filter), std::forward<F>(callback));
+  }
+
+  /**
+   * \brief add an event listener keyed on the first event argument
+   * \param event     a pointer to a member function identifying the event
+   * \param key       the value the first event argument is compared against
+   * \param callback  a function that is called when the first argument equals \a key
+   * \param priority  priority tier of the listener (lower tiers run first)
+   *
+   * This is onFiltered() specialized for an equality filter on the first
+   * argument: the key is stored in the listener node and the check performed
+   * by emit() is a single compare, so listeners that key on, say, an
+   * instrument id can be registered by the thousands on the same event
+   * without every emission paying a callback invocation per listener.
+   */
+  template<typename T, typename Key, typename F, typename First, typename... Rest>
+  ConnectionData onKeyed(void (T::*event)(First, Rest...), Key&& key, F&& callback, int priority = 0)
+  {
+    return addListenerNode<details::KeyedEventListener<std::decay_t<F>, std::decay_t<Key>, First, Rest...>>(
+      m_buckets[details::EventKey::make(event)], false, priority,
+      std::forward<Key>(key), std::forward<F>(callback));
+  }
+
+  /**
+   * \brief add a conflating event listener
+   * \param event     a pointer to a member function identifying the event
+   * \param callback  a function that is called when the emitter is flushed
+   *
+   * Unlike a listener registered with on(), a conflating listener is not
+   * invoked by emit(): each emission merely overwrites the listener's
+   * pending argument pack. The callback is invoked - with the latest
+   * arguments only - when flushConflated() is called. This bounds the work
+   * done on behalf of the listener to the flush rate rather than the
+   * emission rate, which suits high-frequency events whose consumers only
+   * care about the most recent value.
+   */
+  template<typename T, typename F, typename... Args>
+  ConnectionData onConflated(void (T::*event)(Args...), F&& callback)
+  {
+    ConnectionData c = addListenerNode<details::ConflatingEventListener<F, Args...>>(m_buckets[details::EventKey::make(event)], false, 0, std::forward<F>(callback));
+    m_conflated.push_back(c.connection_id);
+    return c;
+  }
+
+  /**
+   * \brief delivers the pending emissions of the conflating listeners
+   * \return the number of listeners that were invoked
+   *
+   * Listeners with no pending emission since the last flush are skipped.
+   *
+   * Conflating listeners registered by a flushed callback are not visited
+   * by the in-flight flush; a reentrant call to flushConflated() from a
+   * callback is a no-op.
+   */
+  std::size_t flushConflated()
+  {
+    if (m_flushing)
+    {
+      return 0;
+    }
+
+    m_flushing = true;
+
+    // the emit scope makes disconnections from inside a callback safe,
+    // exactly as during a regular dispatch.
+    EmitScope scope{*this};
+
+    std::size_t count = 0;
+
+    // iterate by index over a snapshot of the size: a flushed callback may
+    // call onConflated(), growing m_conflated; stale ids are compacted out
+    // in the same pass.
+    const std::size_t size = m_conflated.size();
+    std::size_t live = 0;
+
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      const int id = m_conflated[i];
+      const int index = slotIndex(id);
+
+      if (index < 0 || index >= static_cast<int>(m_slots.size()))
+      {
+        continue;
+      }
+
+      Slot& slot = m_slots[index];
+
+      if (!slot.listener || slot.dead || connectionId(index, slot.generation) != id)
+      {
+        // the listener is gone; drop the stale id.
+        continue;
+      }
+
+      m_conflated[live++] = id;
+
+      if (slot.listener->flush())
+      {
+        ++count;
+      }
+    }
+
+    m_conflated.erase(m_conflated.begin() + live, m_conflated.begin() + size);
+
+    m_flushing = false;
+
+    return count;
+  }
+
+  /**
+   * \brief fires an event
+   * \param event  a pointer to a member function identifying the event
+   * \param args   event data (template pack)
+   *
+   * The arguments in \a args must have types that are compatible with a call
+   * to the \a event function.
+   *
+   * Only the listeners registered for \a event are visited: listeners are
+   * stored in per-event buckets so the cost of an emit is proportional to
+   * the number of matching listeners, not to the total number of listeners.
+   */
+  template<typename T, typename... Params, typename... Args>
+  void emit(void (T::*event)(Params...), Args &&...args)
+  {
+    dispatch(details::EventKey::make(event), event, std::forward<Args>(args)...);
+  }
+
+  /**
+   * \brief fires an event (compile-time event variant)
+   * \tparam Event  a pointer to a member function identifying the event
+   * \param args    event data (template pack)
+   *
+   * This behaves like emit(event, args...) but takes the event as a non-type
+   * template parameter, so the event key is computed once per instantiation
+   * and the hot path is a plain bucket lookup.
+   */
+  template<auto Event, typename... Args>
+  void emit(Args &&...args)
+  {
+    static const details::EventKey key = details::EventKey::make(Event);
+    dispatch(key, Event, std::forward<Args>(args)...);
+  }
+
+  /**
+   * \brief fires an event, invoking its listeners in parallel
+   * \param pool   the thread pool the invocations are dispatched to
+   * \param event  a pointer to a member function identifying the event
+   * \param args   event data (template pack)
+   *
+   * The listeners are snapshotted in registration order and partitioned into
+   * contiguous chunks of parallelGrain() listeners each; the chunks are
+   * executed by the pool (and the calling thread), and the call returns once
+   * every listener has been invoked. The chunk a listener falls into depends
+   * only on its position and the grain, so the partition is stable across
+   * emissions as long as the connections do not change, which keeps
+   * per-listener state local to the core that usually runs it.
+   *
+   * When the event has no more than parallelGrain() listeners, this falls
+   * back to the sequential dispatch of emit(): wide fan-outs get the cores,
+   * small ones skip the synchronization cost.
+   *
+   * \warning the callbacks are invoked concurrently: they must be
+   * thread-safe and must not add or remove connections on this emitter. The
+   * event arguments are passed to every listener from a single frame, as in
+   * a sequential emit.
+   */
+  template<typename T, typename... Params, typename... Args>
+  void emitParallel(ThreadPool& pool, void (T::*event)(Params...), Args&&... args)
+  {
+    const details::EventKey key = details::EventKey::make(event);
+
+    auto bucket_it = m_buckets.find(key);
+
+    if (bucket_it == m_buckets.end())
+    {
+      return;
+    }
+
+    // count the live listeners before snapshotting anything: below the
+    // threshold the sequential path must stay allocation-free.
+    std::size_t live = 0;
+
+    for (int index = bucket_it->second.head; index != -1 && live <= m_parallel_grain; index = m_slots[index].next)
+    {
+      live += m_slots[index].dead ? 0 : 1;
+    }
+
+    if (live <= m_parallel_grain)
+    {
+      dispatch(key, event, std::forward<Args>(args)...);
+      return;
+    }
+
+    std::vector<details::EventListener<Params...>*> listeners;
+    std::vector<int> once_ids;
+    listeners.reserve(live);
+
+    for (int index = bucket_it->second.head; index != -1; index = m_slots[index].next)
+    {
+      Slot& slot = m_slots[index];
+
+      if (slot.dead)
+      {
+        continue;
+      }
+
+      listeners.push_back(static_cast<details::EventListener<Params...>*>(slot.listener.get()));
+
+      if (slot.listener->once_flag)
+      {
+        once_ids.push_back(connectionId(index, slot.generation));
+      }
+    }
+
+    std::tuple<details::frame_element_t<Params, Args>...> frame(std::forward<Args>(args)...);
+
+    std::apply([&](auto&... elems) {
+      pool.parallelFor(listeners.size(), m_parallel_grain, [&listeners, &elems...](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i != end; ++i)
+        {
+          listeners[i]->invoke(elems...);
+        }
+      });
+    }, frame);
+
+    // single-shot listeners are consumed on the calling thread, after the join
+    for (int id : once_ids)
+    {
+      removeListener(id);
+    }
+  }
+
+  /**
+   * \brief returns the listener count under which emitParallel() stays sequential
+   *
+   * The value doubles as the size of the chunks handed to the pool.
+   */
+  std::size_t parallelGrain() const
+  {
+    return m_parallel_grain;
+  }
+
+  /**
+   * \brief sets the sequential threshold and chunk size of emitParallel()
+   */
+  void setParallelGrain(std::size_t grain)
+  {
+    m_parallel_grain = grain == 0 ? 1 : grain;
+  }
+
+  /**
+   * \brief fires an event once per payload of a range
+   * \param event  a pointer to a member function identifying the event
+   * \param begin  iterator on the first payload
+   * \param end    end iterator
+   *
+   * This is equivalent to calling emit(event, payload) for every payload in
+   * the range, except that the listener bucket is resolved only once for the
+   * whole range, which amortizes the matching cost over the batch.
+   *
+   * A payload is passed to the listeners as the single event argument;
+   * for events with several parameters, use a range of std::tuple, whose
+   * elements are expanded into the argument list.
+   */
+  template<typename T, typename... Params, typename Iterator>
+  void emitBatch(void (T::*event)(Params...), Iterator begin, Iterator end)
+  {
+    (void) event;
+
+    auto bucket_it = m_buckets.find(details::EventKey::make(event));
+
+    if (bucket_it == m_buckets.end())
+    {
+      return;
+    }
+
+    // references into m_buckets are stable, so the bucket stays valid even
+    // if a callback registers listeners for other events.
+    Bucket& bucket = bucket_it->second;
+
+    for (auto it = begin; it != end; ++it)
+    {
+      if constexpr (details::is_tuple<std::decay_t<decltype(*it)>>::value)
+      {
+        std::apply([&](auto&&... unpacked) {
+          invokeBucket<Params...>(bucket, std::forward<decltype(unpacked)>(unpacked)...);
+        }, *it);
+      }
+      else
+      {
+        invokeBucket<Params...>(bucket, *it);
+      }
+    }
+  }
+
+  /**
+   * \brief fires an event once per payload of a container
+   *
+   * \overload
+   */
+  template<typename T, typename... Params, typename Container>
+  void emitBatch(void (T::*event)(Params...), const Container& payloads)
+  {
+    emitBatch(event, payloads.begin(), payloads.end());
+  }
+
+  /**
+   * \brief add a listener for a named event
+   * \tparam Params   the parameter list of the event
+   * \param name      the name of the event
+   * \param callback  a function that is called when the event is emitted
+   * \param priority  priority tier of the listener (lower tiers first)
+   * \return the connection data
+   *
+   * Named events are identified by an interned string (see EventName) rather
+   * than a member function pointer, which makes them safe to share across
+   * module boundaries. Since the name carries no signature, the parameter
+   * list is given explicitly: it must be the decayed argument types of the
+   * matching emitNamed() calls.
+   *
+   * The returned connection behaves like any other (removeListener(),
+   * ConnectionHandle...).
+   */
+  template<typename... Params, typename F>
+  ConnectionData onNamed(const EventName& name, F&& callback, int priority = 0)
+  {
+    return addListenerNode<details::FreeFunctionEventListener<Params...>>(namedBucket(name.id()), false, priority, std::forward<F>(callback));
+  }
+
+  /**
+   * \brief add a single-shot listener for a named event
+   *
+   * \sa onNamed(), once().
+   */
+  template<typename... Params, typename F>
+  ConnectionData onceNamed(const EventName& name, F&& callback)
+  {
+    return addListenerNode<details::FreeFunctionEventListener<Params...>>(namedBucket(name.id()), true, 0, std::forward<F>(callback));
+  }
+
+  /**
+   * \brief fires a named event
+   * \param name  the name of the event
+   * \param args  event data (template pack)
+   *
+   * The dispatch is an array lookup with the interned id — no string
+   * hashing or comparison is performed. The decayed types of \a args must
+   * match the parameter list the listeners were registered with.
+   */
+  template<typename... Args>
+  void emitNamed(const EventName& name, Args&&... args)
+  {
+    const int id = name.id();
+
+    if (id < 0 || id >= static_cast<int>(m_named_buckets.size()) || !m_named_buckets[id])
+    {
+      return;
+    }
+
+    invokeBucket<std::decay_t<Args>...>(*m_named_buckets[id], std::forward<Args>(args)...);
+  }
+
+  /**
+   * \brief removes a listener previously registered using on() or once()
+   * \param connection_id  the id of the connection
+   * \return whether a connection was actually removed
+   *
+   * This is O(1): the connection id encodes the index of the listener's slot,
+   * plus a generation counter protecting against slot reuse.
+   */
+  bool removeListener(int connection_id)
+  {
+    const int index = slotIndex(connection_id);
+
+    if (index < 0 || index >= static_cast<int>(m_slots.size()))
+    {
+      return false;
+    }
+
+    Slot& slot = m_slots[index];
+
+    if (!slot.listener || slot.dead || connectionId(index, slot.generation) != connection_id)
+    {
+      return false;
+    }
+
+    if (m_emit_depth > 0)
+    {
+      // an emit is in progress somewhere up the call stack: tombstone the
+      // slot so that iterations over its bucket are not invalidated, and
+      // defer the actual removal to the end of the outermost emit.
+      slot.dead = true;
+      slot.next_dead = m_first_dead;
+      m_first_dead = index;
+    }
+    else
+    {
+      freeSlot(index);
+    }
+
+    return true;
+  }
+
+  /**
+   * \brief removes a batch of listeners
+   * \param connection_ids  pointer to the first connection id
+   * \param count           number of connection ids
+   * \return the number of connections that were actually removed
+   *
+   * Since each removal is O(1), removing a batch is a single pass over the
+   * ids; invalid or stale ids are skipped.
+   */
+  std::size_t removeListeners(const int* connection_ids, std::size_t count)
+  {
+    std::size_t removed = 0;
+
+    for (std::size_t i(0); i < count; ++i)
+    {
+      if (removeListener(connection_ids[i]))
+      {
+        ++removed;
+      }
+    }
+
+    return removed;
+  }
+
+  /**
+   * \brief registers a listener node owned by the caller
+   * \param event     a pointer to a member function identifying the event
+   * \param listener  the listener node
+   * \param once      whether the listener is removed after its first invocation
+   * \param priority  priority tier of the listener
+   * \return the connection data
+   *
+   * Unlike on(), no node is allocated: \a listener is linked directly into
+   * the event's bucket and is never destroyed by the emitter. The caller is
+   * responsible for keeping the node alive while it is connected, or for
+   * disconnecting it first (the coroutine awaiter of awaitable-event.h embeds
+   * its node this way).
+   */
+  template<typename T, typename... Args>
+  ConnectionData addExternalListener(void (T::*event)(Args...), details::EventListener<Args...>* listener, bool once = false, int priority = 0)
+  {
+    const int index = acquireSlot();
+    const int id = connectionId(index, m_slots[index].generation);
+
+    listener->id = id;
+    listener->once_flag = once;
+    listener->priority = priority;
+
+    Bucket& bucket = m_buckets[details::EventKey::make(event)];
+    Slot& slot = m_slots[index];
+    slot.listener = ListenerPtr(listener);
+    slot.external = true;
+    slot.bucket = &bucket;
+    slot.birth = m_emit_serial;
+
+    linkSlot(bucket, index, priority);
+
+    m_mask_dirty = true;
+
+    return {this, id};
+  }
+
+  /**
+   * \brief installs an arena from which listener nodes are allocated
+   * \param arena  the arena, or nullptr to go back to the global allocator
+   *
+   * By default, every call to on() or once() allocates its listener node with
+   * operator new. When an arena is installed, nodes are carved out of the
+   * arena's slabs instead and recycled on disconnection, which keeps heavy
+   * connect/disconnect churn away from the global allocator.
+   *
+   * The arena is not owned by the emitter and must outlive all the listeners
+   * allocated from it. Installing an arena only affects listeners created
+   * afterwards; existing nodes remember their own allocator.
+   */
+  void setListenerArena(Arena* arena)
+  {
+    m_arena = arena;
+  }
+
+  /**
+   * \brief returns the arena installed with setListenerArena(), if any
+   */
+  Arena* listenerArena() const
+  {
+    return m_arena;
+  }
+
+  /**
+   * \brief returns a 64-bit summary of the events that have listeners
+   *
+   * Each event key hashes to one bit of the mask; a set bit means the
+   * emitter may have a listener for an event hashing there, a clear bit
+   * means it definitely has none. Callers can therefore test
+   * eventMask() & eventMaskBit(event) to skip an emit that cannot match
+   * (Object uses this to prune event propagation across a hierarchy).
+   *
+   * The mask is recomputed lazily after a connection or disconnection.
+   */
+  std::uint64_t eventMask() const
+  {
+    if (m_mask_dirty)
+    {
+      m_event_mask = 0;
+
+      for (const auto& entry : m_buckets)
+      {
+        if (entry.second.head != -1)
+        {
+          m_event_mask |= std::uint64_t(1) << (details::EventKeyHash()(entry.first) & 63);
+        }
+      }
+
+      m_mask_dirty = false;
+    }
+
+    return m_event_mask;
+  }
+
+  /**
+   * \brief returns the eventMask() bit associated with an event
+   */
+  template<typename MemFnPtr>
+  static std::uint64_t eventMaskBit(MemFnPtr event)
+  {
+    return std::uint64_t(1) << (details::EventKeyHash()(details::EventKey::make(event)) & 63);
+  }
+
+#if defined(EVENTS_ENABLE_INSTRUMENTATION)
+
+  /**
+   * \brief a copy of the instrumentation data of the emitter
+   *
+   * Only available when the library is built with instrumentation enabled
+   * (EVENTS_ENABLE_INSTRUMENTATION); without it, emit() carries no probes
+   * at all.
+   */
+  struct InstrumentationSnapshot
+  {
+    struct EventEntry
+    {
+      details::EventKey key;
+      std::uint64_t emit_count = 0;
+      LatencyHistogram latency;
+    };
+
+    std::vector<EventEntry> events;
+    std::vector<std::pair<int, ListenerStats>> listeners; // keyed by connection id
+    std::vector<SlowListenerRecord> slow_listeners;
+  };
+
+  /**
+   * \brief sets the duration above which a listener invocation is logged as slow
+   *
+   * Slow invocations are recorded (connection id and duration) in a bounded
+   * ring; by default the threshold is infinite and nothing is logged.
+   */
+  void setSlowListenerThreshold(std::chrono::nanoseconds threshold)
+  {
+    m_slow_threshold_ns = static_cast<std::uint64_t>(threshold.count());
+  }
+
+  /**
+   * \brief takes a snapshot of the instrumentation counters
+   *
+   * The snapshot contains, per event: the number of emissions and a latency
+   * histogram of the whole dispatch; per listener: the invocation count and
+   * cumulative time; plus the slow-listener log.
+   */
+  InstrumentationSnapshot instrumentationSnapshot() const
+  {
+    InstrumentationSnapshot snapshot;
+
+    snapshot.events.reserve(m_event_stats.size());
+
+    for (const auto& e : m_event_stats)
+    {
+      snapshot.events.push_back({e.first, e.second.emit_count, e.second.latency});
+    }
+
+    snapshot.listeners.assign(m_listener_stats.begin(), m_listener_stats.end());
+    snapshot.slow_listeners = m_slow_log.records();
+
+    return snapshot;
+  }
+
+  /**
+   * \brief resets all the instrumentation counters
+   */
+  void clearInstrumentation()
+  {
+    m_event_stats.clear();
+    m_listener_stats.clear();
+    m_slow_log.clear();
+  }
+
+#endif // EVENTS_ENABLE_INSTRUMENTATION
+
+protected:
+  friend class ConnectionHandle;
+  friend class ConnectionList;
+
+  /**
+   * \brief token identifying this emitter in the EmitterRegistry
+   *
+   * A ConnectionHandle copies this token and can therefore test if the
+   * EventEmitter is alive by checking the token against the registry.
+   */
+  details::EmitterRegistry::Token m_lifetoken;
+
+private:
+  /**
+   * \brief optional arena used for allocating listener nodes
+   */
+  Arena* m_arena = nullptr;
+
+  using ListenerPtr = std::unique_ptr<details::AbstractEventListener, details::ListenerDeleter>;
+
+  /**
+   * \brief per-event list of listeners
+   *
+   * A bucket is an intrusive doubly-linked list threaded through the slots
+   * of m_slots; only the indices of the first and last listeners are stored
+   * here. Dispatch walks the list from head to tail, which preserves the
+   * registration order of the listeners of an event.
+   */
+  struct Bucket
+  {
+    int head = -1;
+    int tail = -1;
+  };
+
+  /**
+   * \brief a slot of the listener slot-map
+   *
+   * A slot either holds a listener (and its links within its event bucket)
+   * or is free, in which case \a next is the index of the next free slot.
+   * The generation counter is incremented every time the slot is freed so
+   * that a stale connection id can be detected in O(1).
+   */
+  struct Slot
+  {
+    ListenerPtr listener;
+    Bucket* bucket = nullptr;
+    std::uint32_t generation = 0;
+    int prev = -1;
+    int next = -1;
+
+    /**
+     * \brief whether the listener was removed during an emit
+     *
+     * A listener removed while a dispatch is in progress is only marked dead
+     * (tombstoned): its links stay intact so that in-flight iterations remain
+     * valid, and the slot is actually freed once the outermost emit returns.
+     */
+    bool dead = false;
+    int next_dead = -1;
+
+    /**
+     * \brief whether the listener node is owned by the caller
+     *
+     * External nodes (see addExternalListener()) are unlinked like any other
+     * listener but never destroyed by the emitter.
+     */
+    bool external = false;
+
+    /**
+     * \brief value of the emit serial when the listener was registered
+     *
+     * A dispatch skips the slots born during itself (or during any emit
+     * nested in it), so a listener registered by a callback is never invoked
+     * by the in-flight emit - even when its priority tier inserts it in the
+     * middle of the traversed span.
+     */
+    std::uint64_t birth = 0;
   };
 
-  template<typename... Args>
-  class EventListener : public AbstractEventListener
+  // A connection id packs a slot index (+1, so that valid ids are never 0)
+  // and the low bits of the slot's generation counter. The index field caps
+  // the number of simultaneously live listeners of an emitter at 2^20 - 1;
+  // acquireSlot() asserts on overflow, as a larger index would silently
+  // bleed into the generation bits and alias other connection ids.
+  static constexpr int SlotIndexBits = 20;
+  static constexpr std::uint32_t SlotGenerationMask = 0x7FF;
+
+  static int connectionId(int index, std::uint32_t generation)
   {
-  public:
-    using AbstractEventListener::AbstractEventListener;
-    virtual void invoke(Args... args) = 0;
-  };
+    return static_cast<int>(((generation & SlotGenerationMask) << SlotIndexBits) | static_cast<std::uint32_t>(index + 1));
+  }
 
-  template<typename...Args>
-  class FreeFunctionEventListener : public EventListener<Args...>
+  static int slotIndex(int connection_id)
   {
-  public:
-    FreeFunctionEventListener(int i, void* fp, std::function<void(Args...)> callback)
-      : EventListener<Args...>(i)
-      , m_fn(fp)
-      , m_callback(std::move(callback))
-    {
-    }
-    FreeFunctionEventListener(const FreeFunctionEventListener&) = delete;
-    FreeFunctionEventListener& operator=(const FreeFunctionEventListener&) = delete;
-    ~FreeFunctionEventListener(){}
+    return static_cast<int>(static_cast<std::uint32_t>(connection_id) & ((1u << SlotIndexBits) - 1)) - 1;
+  }
 
-    bool matches(const std::any& signal) const override
+  /**
+   * \brief acquires a slot, recycling a free one if possible
+   * \return the index of the slot
+   */
+  int acquireSlot()
+  {
+    if (m_free_slot != -1)
     {
-      return std::any_cast<void*>(signal) == m_fn;
+      int index = m_free_slot;
+      m_free_slot = m_slots[index].next;
+      m_slots[index].next = -1;
+      return index;
     }
-
-    void invoke(Args... args) override
+    else
     {
-      try {
-        m_callback(std::forward<Args>(args)...);
-      } catch (...) {
-      }
-    }
+      // the new index (+1) must fit in the index field of a connection id
+      assert(m_slots.size() < (1u << SlotIndexBits) - 1);
 
-  private:
-    void* m_fn;
-    std::function<void(Args...)> m_callback;
-  };
+      m_slots.emplace_back();
+      return static_cast<int>(m_slots.size()) - 1;
+    }
+  }
 
-  template<typename Class, typename Callback, typename...Args>
-  class MemberFunctionEventListener : public EventListener<Args...>
+  /**
+   * \brief unlinks a slot from its bucket and pushes it onto the free list
+   */
+  void freeSlot(int index)
   {
-  public:
-    using MemFnPtr = void(Class::*)(Args...);
+    Slot& slot = m_slots[index];
+    Bucket* bucket = slot.bucket;
 
-    MemberFunctionEventListener(int i, MemFnPtr event, Callback callback)
-      : EventListener<Args...>(i)
-      , m_signal(event)
-      , m_callback(std::move(callback))
-    {
-    }
-    MemberFunctionEventListener(const MemberFunctionEventListener&) = delete;
-    MemberFunctionEventListener& operator=(const MemberFunctionEventListener&) = delete;
-    ~MemberFunctionEventListener(){}
+    if (slot.prev != -1)
+      m_slots[slot.prev].next = slot.next;
+    else
+      bucket->head = slot.next;
+
+    if (slot.next != -1)
+      m_slots[slot.next].prev = slot.prev;
+    else
+      bucket->tail = slot.prev;
 
-    bool matches(const std::any& signal) const override
+    if (slot.external)
     {
-      if (signal.type() != typeid(MemFnPtr)) {
-        return false;
-      }
-      return std::any_cast<MemFnPtr>(signal) == m_signal;
+      // the node belongs to the caller and may already be gone: drop the
+      // pointer without touching it.
+      slot.listener.release();
+      slot.external = false;
     }
-
-    void invoke(Args... args) override
+    else
     {
-      try {
-        invoke_relaxed(m_callback, std::forward<Args>(args)...);
-      } catch (...) {
-      }
+      slot.listener.reset();
     }
 
-  private:
-    MemFnPtr m_signal;
-    Callback m_callback;
-  };
+    slot.bucket = nullptr;
+    slot.prev = -1;
+    ++slot.generation;
+    slot.next = m_free_slot;
+    m_free_slot = index;
 
-} // namespace details
+    m_mask_dirty = true;
+  }
 
-class EventEmitter;
+  /**
+   * \brief allocates a listener node, from the arena if one is installed
+   */
+  template<typename ListenerT, typename... CtorArgs>
+  ListenerT* allocListener(CtorArgs&&... ctorargs)
+  {
+    if (m_arena)
+    {
+      void* mem = m_arena->allocate(sizeof(ListenerT));
+      auto* listener = new (mem) ListenerT(std::forward<CtorArgs>(ctorargs)...);
+      listener->arena = m_arena;
+      listener->alloc_size = sizeof(ListenerT);
+      return listener;
+    }
+    else
+    {
+      return new ListenerT(std::forward<CtorArgs>(ctorargs)...);
+    }
+  }
 
-/**
- * \brief POD struct containing information about a connection
- */
-struct ConnectionData
-{
   /**
-   * \brief pointer to the EventEmitter
+   * \brief creates a listener node and appends it to the bucket identified by \a key
+   *
+   * The \a event parameter is only used to deduce the parameter list of the event;
+   * its value is already encoded in \a key.
    */
-  EventEmitter* emitter = nullptr;
+  template<typename T, typename F, typename... Args>
+  ConnectionData addListener(const details::EventKey& key, void (T::*event)(Args...), F&& callback, bool once, int priority = 0)
+  {
+    (void) event;
+
+    // note: references into m_buckets are stable, they are not invalidated
+    // when other elements are inserted or erased.
+    return addListenerNode<details::MemberFunctionEventListener<F, Args...>>(m_buckets[key], once, priority, std::forward<F>(callback));
+  }
 
   /**
-   * \brief id of the connection
+   * \brief creates a listener node of type \a NodeT and inserts it into \a bucket
+   *
+   * The node is inserted at the end of its priority tier, so the bucket is
+   * kept sorted by increasing priority value at all times.
    */
-  int connection_id = 0;
-};
+  template<typename NodeT, typename... CtorArgs>
+  ConnectionData addListenerNode(Bucket& bucket, bool once, int priority, CtorArgs&&... ctor_args)
+  {
+    const int index = acquireSlot();
+    const int id = connectionId(index, m_slots[index].generation);
+
+    auto* listener = allocListener<NodeT>(id, std::forward<CtorArgs>(ctor_args)...);
+    listener->once_flag = once;
+    listener->priority = priority;
+
+    Slot& slot = m_slots[index];
+    slot.listener = ListenerPtr(listener);
+    slot.bucket = &bucket;
+    slot.birth = m_emit_serial;
+
+    linkSlot(bucket, index, priority);
+
+    m_mask_dirty = true;
+
+    return {this, id};
+  }
 
-/**
- * \brief a class providing a mean to emit events that can be listened to 
- * 
- * Events are emitted using the emit() member function.
- * No prior registration of events is necessary. 
- * Any EventEmitter can emit any type of events.
- * Events are identified by a pointer to a member function.
- * 
- * Registering a listener is done by calling on() or once().
- * A ConnectionHandle can be constructed from the return value of these functions 
- * and can be used to manage the lifetime of the connection.
- */
-class EventEmitter
-{
-public:
   /**
-   * \brief constructs an event emitter 
+   * \brief links the slot at \a index into \a bucket
+   *
+   * The slot is inserted at the end of its priority tier, walking back from
+   * the tail; most registrations use the default tier and insert at the tail
+   * directly.
    */
-  EventEmitter()
+  void linkSlot(Bucket& bucket, int index, int priority)
   {
-    m_lifecontrol = std::make_shared<int>(1);
+    Slot& slot = m_slots[index];
+
+    int after = bucket.tail;
+
+    while (after != -1 && m_slots[after].listener->priority > priority)
+      after = m_slots[after].prev;
+
+    slot.prev = after;
+    slot.next = (after == -1) ? bucket.head : m_slots[after].next;
+
+    if (slot.prev != -1)
+      m_slots[slot.prev].next = index;
+    else
+      bucket.head = index;
+
+    if (slot.next != -1)
+      m_slots[slot.next].prev = index;
+    else
+      bucket.tail = index;
   }
 
   /**
-   * \brief add an event listener
-   * \param event     a pointer to a member function identifying the event
-   * \param callback  a function that is called when the event is emitted
-   * 
-   * The parameter list of the callback must match the one of the event.
-   * 
-   * The new listener is added at the end of the list of listeners, meaning that it will 
-   * be called after all other listeners to \a event previously registered.
-   * 
-   * \note \a callback can be any callable object that can be stored in a std::function.
+   * \brief invokes the listeners of the bucket identified by \a key
+   *
+   * The \a event parameter is only used to deduce the parameter list of the event;
+   * its value is already encoded in \a key.
    */
-  template<typename T, typename F, typename... Args>
-  ConnectionData on(void (T::*event)(Args...), F&& callback)
+  template<typename T, typename... Params, typename... Args>
+  void dispatch(const details::EventKey& key, void (T::*event)(Params...), Args&&... args)
   {
-    int id = ++m_id_generator;
-    auto* listener = new details::MemberFunctionEventListener<T, F, Args...>(m_id_generator, event, std::forward<F>(callback));
-    m_listeners.push_back(std::unique_ptr<details::AbstractEventListener>(listener));
-    return {this, id};
+    (void) event;
+
+    auto bucket_it = m_buckets.find(key);
+
+    if (bucket_it == m_buckets.end())
+    {
+#if defined(EVENTS_ENABLE_INSTRUMENTATION)
+      ++m_event_stats[key].emit_count;
+#endif
+      return;
+    }
+
+#if defined(EVENTS_ENABLE_INSTRUMENTATION)
+    const auto start = std::chrono::steady_clock::now();
+
+    invokeBucket<Params...>(bucket_it->second, std::forward<Args>(args)...);
+
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // looked up again: a callback may have emitted another event, and an
+    // insertion into m_event_stats invalidates references.
+    EventInstr& stats = m_event_stats[key];
+    ++stats.emit_count;
+    stats.latency.record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+#else
+    invokeBucket<Params...>(bucket_it->second, std::forward<Args>(args)...);
+#endif
   }
 
   /**
-   * \brief add an event listener that will only be invoked once 
-   * \param event     a pointer to a member function identifying the event
-   * \param callback  a function that is called when the event is emitted
-   * 
-   * This is the same as on(), except that the listener will be automatically removed after
-   * its first invokation (if it ever happens). 
+   * \brief RAII guard tracking the emit depth
+   *
+   * Slots tombstoned during the dispatch are swept when the outermost
+   * emit completes.
    */
-  template<typename T, typename F, typename... Args>
-  ConnectionData once(void (T::*event)(Args...), F &&callback)
+  struct EmitScope
   {
-    int id = ++m_id_generator;
-    auto* listener = new details::MemberFunctionEventListener<T, F, Args...>(m_id_generator, event, std::forward<F>(callback));
-    m_listeners.push_back(std::unique_ptr<details::AbstractEventListener>(listener));
-    listener->once_flag = true;
-    return {this, id};
+    EventEmitter& emitter;
+
+    explicit EmitScope(EventEmitter& e)
+      : emitter(e)
+    {
+      ++emitter.m_emit_depth;
+    }
+
+    ~EmitScope()
+    {
+      if (--emitter.m_emit_depth == 0)
+      {
+        emitter.sweepRemovals();
+      }
+    }
+  };
+
+  /**
+   * \brief frees the slots that were tombstoned during an emit
+   */
+  void sweepRemovals()
+  {
+    while (m_first_dead != -1)
+    {
+      const int index = m_first_dead;
+      m_first_dead = m_slots[index].next_dead;
+      m_slots[index].next_dead = -1;
+      m_slots[index].dead = false;
+      freeSlot(index);
+    }
   }
 
   /**
-   * \brief fires an event
-   * \param event  a pointer to a member function identifying the event
-   * \param args   event data (template pack)
-   * 
-   * The arguments in \a args must have types that are compatible with a call
-   * to the \a event function.
+   * \brief builds the argument frame for an emit and runs the listeners
+   *
+   * The frame materializes each argument at most once (and not at all when
+   * the caller's argument already has the event parameter type); every
+   * listener is then passed borrowed references into the frame, so the
+   * number of copies performed by an emit does not depend on the number
+   * of listeners.
    */
-  template<typename T, typename... Params, typename... Args>
-  void emit(void (T::*event)(Params...), Args &&...args)
+  template<typename... Params, typename... Args>
+  void invokeBucket(Bucket& bucket, Args&&... args)
+  {
+    std::tuple<details::frame_element_t<Params, Args>...> frame(std::forward<Args>(args)...);
+
+    std::apply([&](auto&... elems) {
+      invokeListeners<Params...>(bucket, elems...);
+    }, frame);
+  }
+
+  template<typename... Params, typename... Args>
+  void invokeListeners(Bucket& bucket, Args&&... args)
   {
-    for (auto it = m_listeners.begin(); it != m_listeners.end();)
+    EmitScope scope{*this};
+
+    // listeners registered by a callback are not invoked by this emit: the
+    // common default-tier case appends them past the captured tail, and the
+    // birth serial catches tier-ordered insertions landing inside the
+    // traversed span.
+    const std::uint64_t serial = ++m_emit_serial;
+    const int last = bucket.tail;
+
+    int i = bucket.head;
+
+    while (i != -1)
     {
-      ListenerPtr &l = *it;
+      Slot& slot = m_slots[i];
+      const int next = slot.next;
+      const bool stop = (i == last);
 
-      if (l->matches(event))
+      if (!slot.dead && slot.birth < serial)
       {
-        auto *ll = static_cast<details::EventListener<Params...> *>(l.get());
+        const bool once = slot.listener->once_flag;
+        const int id = slot.listener->id;
+
+        auto* ll = static_cast<details::EventListener<Params...>*>(slot.listener.get());
+
+#if defined(EVENTS_ENABLE_INSTRUMENTATION)
+        const auto invoke_start = std::chrono::steady_clock::now();
+
         ll->invoke(std::forward<Args>(args)...);
 
-        if (l->once_flag)
+        const std::uint64_t invoke_ns = static_cast<std::uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - invoke_start).count());
+
+        ListenerStats& lstats = m_listener_stats[id];
+        ++lstats.invoke_count;
+        lstats.total_ns += invoke_ns;
+
+        if (invoke_ns >= m_slow_threshold_ns)
         {
-          it = m_listeners.erase(it);
+          m_slow_log.record(id, invoke_ns);
         }
-        else
+#else
+        ll->invoke(std::forward<Args>(args)...);
+#endif
+
+        if (once)
         {
-          ++it;
+          // removeListener() validates the connection id, so this is a no-op
+          // if the callback already removed the listener itself.
+          removeListener(id);
         }
       }
-      else
+
+      if (stop)
       {
-        ++it;
+        break;
       }
+
+      i = next;
     }
   }
 
   /**
-   * \brief removes a listener previously registered using on() or once()
-   * \param connection_id  the id of the connection
-   * \return whether a connection was actually removed 
+   * \brief the slots of the listener slot-map
+   *
+   * Listener nodes live in slots addressable by index in O(1); the index and
+   * the slot's generation counter together form the connection id. Removed
+   * slots are chained into a free list (headed by m_free_slot) and reused by
+   * subsequent registrations.
    */
-  bool removeListener(int connection_id)
-  {
-    auto it = std::lower_bound(m_listeners.begin(), m_listeners.end(), connection_id, [](const ListenerPtr &ptr, int cid)
-                               { return ptr->id < cid; });
+  std::vector<Slot> m_slots;
+
+  /**
+   * \brief index of the first free slot, or -1 if there is none
+   */
+  int m_free_slot = -1;
+
+  /**
+   * \brief number of nested emits currently in progress
+   */
+  int m_emit_depth = 0;
+
+  /**
+   * \brief head of the list of slots tombstoned during an emit, or -1
+   */
+  int m_first_dead = -1;
+
+  /**
+   * \brief serial number of the most recently started dispatch
+   *
+   * Stamped into Slot::birth at registration; a dispatch skips slots whose
+   * birth is not older than its own serial.
+   */
+  std::uint64_t m_emit_serial = 0;
+
+  /**
+   * \brief connection ids of the conflating listeners
+   *
+   * Stale ids (disconnected listeners) are lazily dropped by flushConflated().
+   */
+  std::vector<int> m_conflated;
+
+  /**
+   * \brief whether a flushConflated() is in progress (reentrant calls bail out)
+   */
+  bool m_flushing = false;
+
+  /**
+   * \brief per-event buckets referencing the listeners
+   *
+   * Listeners are grouped by the event they listen to, keyed by the
+   * type-erased bytes of the member function pointer identifying the event.
+   */
+  std::unordered_map<details::EventKey, Bucket, details::EventKeyHash> m_buckets;
+
+  /**
+   * \brief per-name buckets of the named events, indexed by interned id
+   *
+   * The table is dense: interned ids are small consecutive integers, so the
+   * dispatch of a named event is a plain array lookup. Buckets are
+   * heap-allocated so that the pointers stored in the slots stay stable
+   * when the table grows.
+   */
+  std::vector<std::unique_ptr<Bucket>> m_named_buckets;
 
-    if (it != m_listeners.end() && (*it)->id == connection_id)
+  /**
+   * \brief sequential threshold and chunk size of emitParallel()
+   */
+  std::size_t m_parallel_grain = 64;
+
+  /**
+   * \brief returns the bucket of a named event, creating it if needed
+   */
+  Bucket& namedBucket(int name_id)
+  {
+    if (name_id >= static_cast<int>(m_named_buckets.size()))
     {
-      m_listeners.erase(it);
-      return true;
+      m_named_buckets.resize(name_id + 1);
     }
-    else
+
+    if (!m_named_buckets[name_id])
     {
-      return false;
+      m_named_buckets[name_id] = std::make_unique<Bucket>();
     }
-  }
 
-protected:
-  friend class ConnectionHandle;
+    return *m_named_buckets[name_id];
+  }
 
   /**
-   * \brief internal shared pointer used to track the lifetime of the EventEmitter
-   * 
-   * This class holds the only strong ref to data, meaning that it is destroyed when 
-   * the EventEmitter is destroyed.
-   * A ConnectionHandle holds a weak pointer to the data and can therefore test if 
-   * the EventEmitter is alive by calling lock() on the weak pointer.
+   * \brief cached listener-presence mask, see eventMask()
    */
-  std::shared_ptr<int> m_lifecontrol;
-  
-private:
-  /**
-   * \brief member variable used to generate listener ids
-  */
-  int m_id_generator = 0;
+  mutable std::uint64_t m_event_mask = 0;
+  mutable bool m_mask_dirty = false;
 
-  using ListenerPtr = std::unique_ptr<details::AbstractEventListener>;
+#if defined(EVENTS_ENABLE_INSTRUMENTATION)
 
   /**
-   * \brief vector containing all the listeners
-   * 
-   * The vector is sorted by increasing connection id.
+   * \brief per-event instrumentation counters
    */
-  std::vector<ListenerPtr> m_listeners;
+  struct EventInstr
+  {
+    std::uint64_t emit_count = 0;
+    LatencyHistogram latency;
+  };
+
+  std::unordered_map<details::EventKey, EventInstr, details::EventKeyHash> m_event_stats;
+  std::unordered_map<int, ListenerStats> m_listener_stats; // keyed by connection id
+  SlowListenerLog m_slow_log;
+  std::uint64_t m_slow_threshold_ns = UINT64_MAX;
+
+#endif // EVENTS_ENABLE_INSTRUMENTATION
 };
 
 /**
  * \brief class for managing a connection to an EventEmitter
- * 
- * This RAII class manages a connection created with EventEmitter::on() or 
+ *
+ * This RAII class manages a connection created with EventEmitter::on() or
  * EventEmitter::once().
- * The connection is automatically removed when the handle is destroyed 
+ * The connection is automatically removed when the handle is destroyed
  * (unless the link was broken using release()).
- * 
+ *
  * Connection handles are not copyable but are movable.
  */
 class ConnectionHandle
 {
 public:
   ConnectionHandle() = default;
-  
-  ConnectionHandle(ConnectionData data) 
+
+  ConnectionHandle(ConnectionData data)
     : m_emitter(data.emitter)
     , m_connection_id(data.connection_id)
   {
     if (m_emitter)
-      m_live = m_emitter->m_lifecontrol;
+      m_live = m_emitter->m_lifetoken;
   }
 
   ConnectionHandle(const ConnectionHandle&) = delete;
-  
+
   ConnectionHandle(ConnectionHandle&& other)
     : m_emitter(other.m_emitter)
     , m_live(other.m_live)
@@ -312,23 +1878,23 @@ public:
   {
     other.release();
   }
-  
+
   ~ConnectionHandle() {
     disconnect();
   }
 
   /**
-   * \brief returns whether the handle refers to a valid connection to an event emitter 
+   * \brief returns whether the handle refers to a valid connection to an event emitter
    */
   bool isValid() const
   {
-    return m_emitter && m_live.lock() != nullptr;
+    return m_emitter && details::EmitterRegistry::instance().isAlive(m_live);
   }
 
   /**
    * \brief returns a pointer to the event emitter that holds the connection
-   * 
-   * \note this function either returns nullptr or a valid pointer to an EventEmitter, 
+   *
+   * \note this function either returns nullptr or a valid pointer to an EventEmitter,
    * it won't return a non-null pointer to an already destroyed EventEmitter.
    */
   EventEmitter* eventEmitter() const
@@ -337,8 +1903,8 @@ public:
   }
 
   /**
-   * \brief returns the id of the connection 
-   * 
+   * \brief returns the id of the connection
+   *
    * The value 0 is used to indicate an invalid connection.
    */
   int connectionId() const
@@ -349,19 +1915,19 @@ public:
   /**
    * \brief breaks the link to the connection
    * \return the id of the connection
-   * 
-   * \note the connection itself remains active, it just will no longer be managed 
+   *
+   * \note the connection itself remains active, it just will no longer be managed
    * by this handle.
    */
   int release()
   {
     m_emitter = nullptr;
-    m_live.reset();
+    m_live = details::EmitterRegistry::Token();
     return std::exchange(m_connection_id, 0);
   }
 
   /**
-   * \brief destroys the connection 
+   * \brief destroys the connection
    */
   void disconnect()
   {
@@ -388,8 +1954,82 @@ public:
 
 private:
   EventEmitter* m_emitter = nullptr;
-  std::weak_ptr<int> m_live;
+  details::EmitterRegistry::Token m_live;
   int m_connection_id = 0;
 };
 
-#endif // EVENT_EMITTER_H
\ No newline at end of file
+/**
+ * \brief a compact registry of connections, grouped by source emitter
+ *
+ * This is a bulk-oriented alternative to storing one ConnectionHandle per
+ * connection: the connection ids are stored densely, one group per emitter,
+ * so disconnecting everything costs a single liveness check and one
+ * removeListeners() pass per emitter instead of a check and a removal per
+ * connection. Objects with many inbound connections use this for teardown.
+ *
+ * Unlike ConnectionHandle, a ConnectionList does not support releasing or
+ * disconnecting individual connections.
+ */
+class ConnectionList
+{
+public:
+  ConnectionList() = default;
+  ConnectionList(const ConnectionList&) = delete;
+  ConnectionList& operator=(const ConnectionList&) = delete;
+
+  ~ConnectionList()
+  {
+    disconnectAll();
+  }
+
+  /**
+   * \brief records a connection in the registry
+   */
+  void add(const ConnectionData& connection)
+  {
+    if (!connection.emitter || connection.connection_id == 0)
+    {
+      return;
+    }
+
+    Group& group = m_groups[connection.emitter];
+
+    if (group.ids.empty())
+    {
+      group.token = connection.emitter->m_lifetoken;
+    }
+
+    group.ids.push_back(connection.connection_id);
+  }
+
+  /**
+   * \brief disconnects all the recorded connections
+   *
+   * Groups whose emitter has already been destroyed are simply dropped.
+   */
+  void disconnectAll()
+  {
+    for (auto& entry : m_groups)
+    {
+      const Group& group = entry.second;
+
+      if (details::EmitterRegistry::instance().isAlive(group.token))
+      {
+        entry.first->removeListeners(group.ids.data(), group.ids.size());
+      }
+    }
+
+    m_groups.clear();
+  }
+
+private:
+  struct Group
+  {
+    details::EmitterRegistry::Token token;
+    std::vector<int> ids;
+  };
+
+  std::unordered_map<EventEmitter*, Group> m_groups;
+};
+
+#endif // EVENT_EMITTER_H
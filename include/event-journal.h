@@ -0,0 +1,414 @@
+// Copyright (C) 2023 Vincent Chambrin
+// This file is part of the 'events' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef EVENT_JOURNAL_H
+#define EVENT_JOURNAL_H
+
+#include "event-emitter.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define EVENTS_JOURNAL_USE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define EVENTS_JOURNAL_USE_MMAP 0
+#endif
+
+/**
+ * \brief a persistent ring journal of emitted events
+ *
+ * The journal records events — the type-erased event key plus the raw bytes
+ * of the (trivially-copyable) arguments — into a fixed-size ring backed by a
+ * memory-mapped file, so recording costs a couple of memcpy into mapped
+ * memory, not formatted I/O. When the ring is full, the oldest records are
+ * overwritten. A record is published by advancing the tail offset only after
+ * its bytes are fully written, which keeps the file consistent if the
+ * process dies mid-record.
+ *
+ * replay() re-drives the recorded events of a given type through
+ * EventEmitter::emit(), e.g. to rebuild state after a crash or to feed an
+ * audit pipeline.
+ *
+ * On platforms without mmap the ring lives in memory and is loaded/saved
+ * from the file on open/close; recording works identically but crash
+ * consistency is lost.
+ */
+class EventJournal
+{
+public:
+  /**
+   * \brief opens (or creates) a journal file
+   * \param path      the path of the journal file
+   * \param capacity  the size of the ring, in bytes
+   *
+   * If the file already holds a journal with the same capacity, its records
+   * are preserved; otherwise it is re-initialized.
+   */
+  EventJournal(const char* path, std::size_t capacity = 1 << 20)
+  {
+    capacity = alignUp(capacity < MinCapacity ? MinCapacity : capacity, 8);
+
+#if EVENTS_JOURNAL_USE_MMAP
+    const int fd = ::open(path, O_RDWR | O_CREAT, 0644);
+
+    if (fd == -1)
+    {
+      return;
+    }
+
+    struct stat st;
+    const bool existed = ::fstat(fd, &st) == 0 && st.st_size == static_cast<off_t>(sizeof(FileHeader) + capacity);
+
+    if (!existed && ::ftruncate(fd, static_cast<off_t>(sizeof(FileHeader) + capacity)) != 0)
+    {
+      ::close(fd);
+      return;
+    }
+
+    void* mem = ::mmap(nullptr, sizeof(FileHeader) + capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (mem == MAP_FAILED)
+    {
+      return;
+    }
+
+    m_header = static_cast<FileHeader*>(mem);
+    m_data = reinterpret_cast<unsigned char*>(m_header + 1);
+
+    if (!existed || m_header->magic != Magic || m_header->capacity != capacity)
+    {
+      m_header->magic = Magic;
+      m_header->capacity = capacity;
+      m_header->head = 0;
+      m_header->tail = 0;
+    }
+#else
+    m_path = path;
+    m_storage = static_cast<unsigned char*>(std::malloc(sizeof(FileHeader) + capacity));
+
+    if (!m_storage)
+    {
+      return;
+    }
+
+    m_header = reinterpret_cast<FileHeader*>(m_storage);
+    m_data = m_storage + sizeof(FileHeader);
+
+    bool loaded = false;
+
+    if (std::FILE* file = std::fopen(path, "rb"))
+    {
+      loaded = std::fread(m_storage, 1, sizeof(FileHeader) + capacity, file) == sizeof(FileHeader) + capacity
+            && m_header->magic == Magic && m_header->capacity == capacity;
+      std::fclose(file);
+    }
+
+    if (!loaded)
+    {
+      m_header->magic = Magic;
+      m_header->capacity = capacity;
+      m_header->head = 0;
+      m_header->tail = 0;
+    }
+#endif
+  }
+
+  EventJournal(const EventJournal&) = delete;
+  EventJournal& operator=(const EventJournal&) = delete;
+
+  ~EventJournal()
+  {
+#if EVENTS_JOURNAL_USE_MMAP
+    if (m_header)
+    {
+      ::munmap(m_header, sizeof(FileHeader) + m_header->capacity);
+    }
+#else
+    if (m_header)
+    {
+      if (std::FILE* file = std::fopen(m_path.c_str(), "wb"))
+      {
+        std::fwrite(m_storage, 1, sizeof(FileHeader) + m_header->capacity, file);
+        std::fclose(file);
+      }
+
+      std::free(m_storage);
+    }
+#endif
+  }
+
+  /**
+   * \brief returns whether the journal file was successfully opened
+   */
+  bool isOpen() const
+  {
+    return m_header != nullptr;
+  }
+
+  /**
+   * \brief discards all the records
+   */
+  void clear()
+  {
+    if (m_header)
+    {
+      m_header->head = 0;
+      m_header->tail = 0;
+    }
+  }
+
+  /**
+   * \brief appends an event to the journal
+   * \param event  a pointer to a member function identifying the event
+   * \param args   event data, stored by value
+   * \return whether the event was recorded
+   *
+   * The (decayed) event parameters must be trivially copyable: their bytes
+   * are copied straight into the mapped ring.
+   */
+  template<typename T, typename... Params, typename... Args>
+  bool record(void (T::*event)(Params...), const Args&... args)
+  {
+    static_assert((std::is_trivially_copyable_v<std::decay_t<Params>> && ...),
+                  "journal payloads must be trivially copyable");
+
+    if (!m_header)
+    {
+      return false;
+    }
+
+    const std::size_t payload = payloadSize<std::decay_t<Params>...>();
+    const std::uint32_t total = static_cast<std::uint32_t>(alignUp(sizeof(RecordHeader) + payload, 8));
+
+    if (total > m_header->capacity)
+    {
+      return false;
+    }
+
+    unsigned char* dst = reserve(total);
+
+    auto* header = reinterpret_cast<RecordHeader*>(dst);
+    header->size = total;
+    header->payload_size = static_cast<std::uint32_t>(payload);
+    header->key = details::EventKey::make(event);
+
+    std::size_t offset = 0;
+    (writeArg<std::decay_t<Params>>(dst + sizeof(RecordHeader), offset, args), ...);
+
+    // publish the record only once it is fully written
+    m_header->tail += total;
+    return true;
+  }
+
+  /**
+   * \brief records an event and emits it
+   *
+   * This is the journaling stage to substitute for a direct emit() on the
+   * hot path: the event goes into the ring first, then through the regular
+   * dispatch.
+   */
+  template<typename T, typename... Params, typename... Args>
+  void emit(EventEmitter& emitter, void (T::*event)(Params...), Args&&... args)
+  {
+    record(event, args...);
+    emitter.emit(event, std::forward<Args>(args)...);
+  }
+
+  /**
+   * \brief re-emits the recorded events of a given type
+   * \param emitter  the emitter through which the events are re-driven
+   * \param event    a pointer to a member function identifying the event
+   * \return the number of events that were replayed
+   *
+   * Records are replayed oldest first; records of other events are skipped.
+   * The journal is left untouched, so a replay can be repeated.
+   */
+  template<typename T, typename... Params>
+  std::size_t replay(EventEmitter& emitter, void (T::*event)(Params...)) const
+  {
+    if (!m_header)
+    {
+      return 0;
+    }
+
+    const details::EventKey key = details::EventKey::make(event);
+    std::size_t replayed = 0;
+
+    std::uint64_t cursor = m_header->head;
+
+    while (cursor < m_header->tail)
+    {
+      const std::size_t pos = cursor % m_header->capacity;
+      const std::size_t remaining = m_header->capacity - pos;
+
+      if (remaining < sizeof(RecordHeader))
+      {
+        // implicit padding at the end of the ring
+        cursor += remaining;
+        continue;
+      }
+
+      const auto* header = reinterpret_cast<const RecordHeader*>(m_data + pos);
+
+      if (header->payload_size != WrapMarker && header->key == key)
+      {
+        std::size_t offset = 0;
+        const unsigned char* payload = m_data + pos + sizeof(RecordHeader);
+
+        std::tuple<std::decay_t<Params>...> unpacked{ readArg<std::decay_t<Params>>(payload, offset)... };
+
+        std::apply([&](auto&... elems) {
+          emitter.emit(event, elems...);
+        }, unpacked);
+
+        ++replayed;
+      }
+
+      cursor += header->size;
+    }
+
+    return replayed;
+  }
+
+private:
+  static constexpr std::uint64_t Magic = 0x4a4e5256455645ull; // "EVEVRNJ"
+  static constexpr std::uint32_t WrapMarker = 0xFFFFFFFFu;
+  static constexpr std::size_t MinCapacity = 4096;
+
+  struct FileHeader
+  {
+    std::uint64_t magic;
+    std::uint64_t capacity;
+    std::uint64_t head; // monotonically increasing offset of the oldest record
+    std::uint64_t tail; // monotonically increasing offset past the newest record
+  };
+
+  struct RecordHeader
+  {
+    std::uint32_t size;         // total record size, header included, multiple of 8
+    std::uint32_t payload_size; // WrapMarker for the filler before a ring wrap
+    details::EventKey key;
+  };
+
+  static std::size_t alignUp(std::size_t value, std::size_t alignment)
+  {
+    return (value + alignment - 1) & ~(alignment - 1);
+  }
+
+  template<typename... Ps>
+  static std::size_t payloadSize()
+  {
+    std::size_t offset = 0;
+    ((offset = alignUp(offset, alignof(Ps)), offset += sizeof(Ps)), ...);
+    return offset;
+  }
+
+  template<typename P, typename A>
+  static void writeArg(unsigned char* base, std::size_t& offset, const A& arg)
+  {
+    const P value = static_cast<P>(arg);
+    offset = alignUp(offset, alignof(P));
+    std::memcpy(base + offset, &value, sizeof(P));
+    offset += sizeof(P);
+  }
+
+  template<typename P>
+  static P readArg(const unsigned char* base, std::size_t& offset)
+  {
+    P value;
+    offset = alignUp(offset, alignof(P));
+    std::memcpy(&value, base + offset, sizeof(P));
+    offset += sizeof(P);
+    return value;
+  }
+
+  /**
+   * \brief drops the oldest record
+   */
+  void evict()
+  {
+    const std::size_t pos = m_header->head % m_header->capacity;
+    const std::size_t remaining = m_header->capacity - pos;
+
+    if (remaining < sizeof(RecordHeader))
+    {
+      m_header->head += remaining;
+      return;
+    }
+
+    m_header->head += reinterpret_cast<const RecordHeader*>(m_data + pos)->size;
+  }
+
+  /**
+   * \brief makes room for a contiguous record of \a total bytes and returns
+   * its address
+   *
+   * Old records are evicted as needed; if the record does not fit in the
+   * space left before the end of the ring, a wrap filler is written there
+   * and the record starts back at offset zero.
+   */
+  unsigned char* reserve(std::uint32_t total)
+  {
+    for (;;)
+    {
+      const std::size_t pos = m_header->tail % m_header->capacity;
+      const std::size_t remaining = m_header->capacity - pos;
+
+      if (remaining < sizeof(RecordHeader))
+      {
+        while (m_header->capacity - (m_header->tail - m_header->head) < remaining)
+        {
+          evict();
+        }
+
+        m_header->tail += remaining; // implicit padding, mirrored by the readers
+        continue;
+      }
+
+      if (total > remaining)
+      {
+        while (m_header->capacity - (m_header->tail - m_header->head) < remaining)
+        {
+          evict();
+        }
+
+        auto* filler = reinterpret_cast<RecordHeader*>(m_data + pos);
+        filler->size = static_cast<std::uint32_t>(remaining);
+        filler->payload_size = WrapMarker;
+        filler->key = details::EventKey();
+
+        m_header->tail += remaining;
+        continue;
+      }
+
+      while (m_header->capacity - (m_header->tail - m_header->head) < total)
+      {
+        evict();
+      }
+
+      return m_data + pos;
+    }
+  }
+
+private:
+  FileHeader* m_header = nullptr;
+  unsigned char* m_data = nullptr;
+#if !EVENTS_JOURNAL_USE_MMAP
+  std::string m_path;
+  unsigned char* m_storage = nullptr;
+#endif
+};
+
+#endif // EVENT_JOURNAL_H
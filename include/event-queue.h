@@ -0,0 +1,159 @@
+// Copyright (C) 2023 Vincent Chambrin
+// This file is part of the 'events' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef EVENTS_EVENT_QUEUE_H
+#define EVENTS_EVENT_QUEUE_H
+
+#include "callback.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/**
+ * \brief a bounded multi-producer, single-consumer queue of invocations
+ *
+ * Producers post ready-to-run invocations with post(); a single consumer
+ * thread runs the pending invocations by calling drain(). The queue is a
+ * lock-free ring buffer: posting involves no lock and no allocation as long
+ * as the posted callable fits in the inline storage of an Invocation.
+ *
+ * The queue is bounded: post() fails (returns false) when the ring is full,
+ * so a slow consumer exerts back-pressure on producers instead of growing
+ * the queue without limit.
+ *
+ * This is the delivery mechanism behind the queued variant of
+ * Object::connect(), but it can also be used on its own.
+ */
+class EventQueue
+{
+public:
+  /**
+   * \brief a type-erased pending invocation
+   *
+   * The inline capacity accommodates a typical callback plus a few captured
+   * arguments without allocating.
+   */
+  using Invocation = Callback<void(), 6 * sizeof(void*)>;
+
+  /**
+   * \brief constructs a queue
+   * \param capacity  the maximum number of pending invocations (rounded up to a power of two)
+   */
+  explicit EventQueue(std::size_t capacity = 1024)
+  {
+    std::size_t cap = 1;
+
+    while (cap < capacity)
+      cap <<= 1;
+
+    m_slots = std::make_unique<Slot[]>(cap);
+    m_mask = cap - 1;
+
+    for (std::size_t i(0); i < cap; ++i)
+    {
+      m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  EventQueue(const EventQueue&) = delete;
+  EventQueue& operator=(const EventQueue&) = delete;
+
+  /**
+   * \brief enqueues an invocation
+   * \param f  a callable taking no argument
+   * \return whether the invocation was enqueued (false if the queue is full)
+   *
+   * This function is thread-safe and may be called from any thread.
+   */
+  template<typename F>
+  bool post(F&& f)
+  {
+    std::size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+      Slot& slot = m_slots[pos & m_mask];
+      const std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+      const auto dif = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+
+      if (dif == 0)
+      {
+        if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          slot.invocation = Invocation(std::forward<F>(f));
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (dif < 0)
+      {
+        return false;
+      }
+      else
+      {
+        pos = m_enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * \brief runs the pending invocations
+   * \return the number of invocations that were run
+   *
+   * This function must only be called from the consumer thread.
+   * Each slot is released before its invocation runs, so a long-running
+   * callback does not prevent producers from reusing the slot, and a
+   * callback may itself post() new invocations.
+   */
+  std::size_t drain()
+  {
+    std::size_t count = 0;
+
+    for (;;)
+    {
+      Slot& slot = m_slots[m_dequeue_pos & m_mask];
+      const std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+
+      if (seq != m_dequeue_pos + 1)
+      {
+        break;
+      }
+
+      Invocation invocation = std::move(slot.invocation);
+      slot.sequence.store(m_dequeue_pos + m_mask + 1, std::memory_order_release);
+      ++m_dequeue_pos;
+
+      invocation();
+      ++count;
+    }
+
+    return count;
+  }
+
+  /**
+   * \brief returns the capacity of the queue
+   */
+  std::size_t capacity() const
+  {
+    return m_mask + 1;
+  }
+
+private:
+  struct Slot
+  {
+    std::atomic<std::size_t> sequence{0};
+    Invocation invocation;
+  };
+
+private:
+  std::unique_ptr<Slot[]> m_slots;
+  std::size_t m_mask = 0;
+
+  // producers and the consumer write to distinct cache lines
+  alignas(64) std::atomic<std::size_t> m_enqueue_pos{0};
+  alignas(64) std::size_t m_dequeue_pos = 0;
+};
+
+#endif // EVENTS_EVENT_QUEUE_H
@@ -0,0 +1,131 @@
+// Copyright (C) 2023 Vincent Chambrin
+// This file is part of the 'events' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#if defined(EVENTS_ENABLE_INSTRUMENTATION)
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * \brief a latency histogram with power-of-two buckets
+ *
+ * Bucket \a b counts the samples whose duration, in nanoseconds, needs
+ * \a b bits to be written down — i.e. durations in [2^(b-1), 2^b).
+ * Recording a sample is a shift loop and an increment, cheap enough to sit
+ * on the dispatch path.
+ */
+class LatencyHistogram
+{
+public:
+  static constexpr std::size_t BucketCount = 32;
+
+  void record(std::uint64_t nanoseconds)
+  {
+    ++m_buckets[bucketFor(nanoseconds)];
+    m_total_ns += nanoseconds;
+    ++m_count;
+  }
+
+  static std::size_t bucketFor(std::uint64_t nanoseconds)
+  {
+    std::size_t b = 0;
+
+    while (nanoseconds != 0 && b < BucketCount - 1)
+    {
+      nanoseconds >>= 1;
+      ++b;
+    }
+
+    return b;
+  }
+
+  const std::array<std::uint64_t, BucketCount>& buckets() const
+  {
+    return m_buckets;
+  }
+
+  std::uint64_t count() const
+  {
+    return m_count;
+  }
+
+  std::uint64_t totalNanoseconds() const
+  {
+    return m_total_ns;
+  }
+
+private:
+  std::array<std::uint64_t, BucketCount> m_buckets = {};
+  std::uint64_t m_total_ns = 0;
+  std::uint64_t m_count = 0;
+};
+
+/**
+ * \brief cumulative invocation statistics of a single listener
+ */
+struct ListenerStats
+{
+  std::uint64_t invoke_count = 0;
+  std::uint64_t total_ns = 0;
+};
+
+/**
+ * \brief records a listener invocation that exceeded the slow threshold
+ */
+struct SlowListenerRecord
+{
+  int connection_id = 0;
+  std::uint64_t ns = 0;
+};
+
+/**
+ * \brief a bounded log of slow-listener records
+ *
+ * The log is a ring: once full, a new record overwrites the oldest one, so
+ * a storm of slow invocations cannot grow it without bound.
+ */
+class SlowListenerLog
+{
+public:
+  static constexpr std::size_t Capacity = 64;
+
+  void record(int connection_id, std::uint64_t ns)
+  {
+    if (m_records.size() < Capacity)
+    {
+      m_records.push_back({connection_id, ns});
+    }
+    else
+    {
+      m_records[m_next] = {connection_id, ns};
+    }
+
+    m_next = (m_next + 1) % Capacity;
+  }
+
+  const std::vector<SlowListenerRecord>& records() const
+  {
+    return m_records;
+  }
+
+  void clear()
+  {
+    m_records.clear();
+    m_next = 0;
+  }
+
+private:
+  std::vector<SlowListenerRecord> m_records;
+  std::size_t m_next = 0;
+};
+
+#endif // EVENTS_ENABLE_INSTRUMENTATION
+
+#endif // INSTRUMENTATION_H
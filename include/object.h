@@ -6,15 +6,28 @@
 #define OBJECT_H
 
 #include  "event-emitter.h"
+#include  "event-queue.h"
+
+#include <algorithm>
+#include <cstdint>
+
+/**
+ * @brief tag type selecting the conflated connection mode in Object::connect()
+ */
+struct ConflatedConnection {};
 
 /**
  * @brief a class providing an event-listening mechanism similar to Qt signal/slot system
- * 
- * Subclasses can emit signals by declaring them as member functions and using emit() 
+ *
+ * Subclasses can emit signals by declaring them as member functions and using emit()
  * for emitting the signal.
  * Connections are made using the various overloads of the connect() function.
- * 
- * Currently the system is single-threaded: slot invocation is performed immediately 
+ *
+ * Objects can be organized into a tree with setParent(); emitBubbling() and
+ * emitCapturing() then propagate a signal along the chain of ancestors, with
+ * a listener-presence mask pruning the hops that cannot match.
+ *
+ * Currently the system is single-threaded: slot invocation is performed immediately
  * in the thread that emitted the signal.
  */
 class Object
@@ -31,14 +44,42 @@ public:
   template<typename SrcT, typename DestT, typename SigObjT, typename... SrcArgs, typename... DestArgs>
   static void connect(SrcT* srcObject, void (SigObjT::*event)(SrcArgs...), DestT* destObject, void (DestT::*slotFunc)(DestArgs...));
 
+  template<typename SrcT, typename SigObjT, typename F, typename... Args>
+  static void connect(SrcT* srcObject, void (SigObjT::*event)(Args...), EventQueue* queue, F&& callback);
+
+  template<typename SrcT, typename SigObjT, typename F, typename... Args>
+  static void connect(SrcT* srcObject, void (SigObjT::*event)(Args...), ConflatedConnection, F&& callback);
+
+  std::size_t flushConflated();
+
   template<typename T, typename... Params, typename... Args>
   void emit(void (T::*event)(Params...), Args &&...args);
 
+  Object* parent() const;
+  void setParent(Object* parent);
+  const std::vector<Object*>& children() const;
+
+  template<typename T, typename... Params, typename... Args>
+  void emitBubbling(void (T::*event)(Params...), Args &&...args);
+
+  template<typename T, typename... Params, typename... Args>
+  void emitCapturing(void (T::*event)(Params...), Args &&...args);
+
+private:
+  void refreshAncestorMask();
+  void listenerAdded();
+
+  template<typename T, typename... Params, typename... Args>
+  void emitCapturingHelper(std::uint64_t bit, void (T::*event)(Params...), Args &...args);
+
 private:
   EventEmitter m_events; // stores the connections where this object is the source of the signal and handles signal emission.
-  std::vector<ConnectionHandle> m_connection_list; // stores the connection in which this object receives the notification.
-                                                   // this is used to automatically break the connections when this object
-                                                   // is destroyed.
+  ConnectionList m_connection_list; // stores the connections in which this object receives the notification,
+                                    // grouped by source emitter. this is used to break all the connections
+                                    // in bulk when this object is destroyed.
+  Object* m_parent = nullptr;
+  std::vector<Object*> m_children;
+  std::uint64_t m_ancestor_mask = 0; // union of the eventMask() of all the ancestors, see emitBubbling()
 };
 
 /**
@@ -69,6 +110,7 @@ inline void Object::connect(SrcT* srcObject, void (SigObjT::*event)(Args...), F&
   static_assert(std::is_base_of_v<Object, SrcT>, "Source object must be derived from Object");
   auto* src = static_cast<Object*>(srcObject);
   src->m_events.on(event, std::forward<F>(callback));
+  src->listenerAdded();
 }
 
 /**
@@ -89,8 +131,8 @@ inline void Object::connect(SrcT* srcObject, void (SigObjT::*event)(SrcArgs...),
   static_assert(std::is_base_of_v<Object, ContextT>, "Context object must be derived from Object");
   auto *src = static_cast<Object *>(srcObject);
   auto *context = static_cast<Object *>(contextObject);
-  ConnectionHandle handle = src->m_events.on(event, std::forward<F>(callable));
-  context->m_connection_list.push_back(std::move(handle));
+  context->m_connection_list.add(src->m_events.on(event, std::forward<F>(callable)));
+  src->listenerAdded();
 }
 
 /**
@@ -109,4 +151,212 @@ inline void Object::connect(SrcT *srcObject, void (SigObjT::*event)(SrcArgs...),
                                              { std::invoke(slotFunc, *destObject, std::forward<DestArgs>(data)...); });
 }
 
+/**
+ * @brief connects a signal to a callback invoked through an event queue
+ * @param srcObject  the object that may emit the signal
+ * @param event      a pointer to a member function representing the signal
+ * @param queue      the queue through which the callback is invoked
+ * @param callback   a function to call when the signal is emitted
+ *
+ * This is the queued counterpart of the direct connection: emitting the
+ * signal does not invoke @a callback immediately but enqueues an invocation
+ * (with copies of the signal arguments) into @a queue. The callback runs in
+ * whichever thread drains the queue, which makes this the connection type to
+ * use for crossing thread boundaries.
+ *
+ * @note if @a queue is full when the signal is emitted, the emission is
+ * dropped for this connection.
+ *
+ * @warning the connection remains active until @a srcObject is destroyed;
+ * both @a queue and @a callback must stay valid until then.
+ */
+template<typename SrcT, typename SigObjT, typename F, typename... Args>
+inline void Object::connect(SrcT* srcObject, void (SigObjT::*event)(Args...), EventQueue* queue, F&& callback)
+{
+  static_assert(std::is_base_of_v<Object, SrcT>, "Source object must be derived from Object");
+  auto* src = static_cast<Object*>(srcObject);
+  src->m_events.on(event, [queue, callback = std::decay_t<F>(std::forward<F>(callback))](Args... args) {
+    queue->post([callback, args...]() mutable {
+      invoke_relaxed(callback, std::move(args)...);
+    });
+  });
+  src->listenerAdded();
+}
+
+/**
+ * @brief connects a signal to a callback with latest-value conflation
+ * @param srcObject  the object that may emit the signal
+ * @param event      a pointer to a member function representing the signal
+ * @param callback   a function invoked with the latest signal arguments
+ *
+ * Emitting the signal does not invoke @a callback: each emission overwrites
+ * the pending argument pack of the connection. The callback is invoked with
+ * the most recent arguments when flushConflated() is called on @a srcObject.
+ *
+ * @warning the connection will remain active until @a srcObject is destroyed so
+ * be careful about the lifetime of @a callback.
+ */
+template<typename SrcT, typename SigObjT, typename F, typename... Args>
+inline void Object::connect(SrcT* srcObject, void (SigObjT::*event)(Args...), ConflatedConnection, F&& callback)
+{
+  static_assert(std::is_base_of_v<Object, SrcT>, "Source object must be derived from Object");
+  auto* src = static_cast<Object*>(srcObject);
+  src->m_events.onConflated(event, std::forward<F>(callback));
+  src->listenerAdded();
+}
+
+/**
+ * @brief delivers the pending emissions of this object's conflated connections
+ * @return the number of callbacks that were invoked
+ */
+inline std::size_t Object::flushConflated()
+{
+  return m_events.flushConflated();
+}
+
+/**
+ * @brief returns the parent of this object, or nullptr
+ */
+inline Object* Object::parent() const
+{
+  return m_parent;
+}
+
+/**
+ * @brief makes this object a child of @a parent
+ * @param parent  the new parent, or nullptr to detach the object
+ *
+ * The object is removed from the children of its previous parent, and the
+ * ancestor masks of its whole subtree are refreshed.
+ *
+ * @note the parent does not own its children; destroying either side simply
+ * detaches the other.
+ */
+inline void Object::setParent(Object* parent)
+{
+  if (m_parent == parent)
+  {
+    return;
+  }
+
+  if (m_parent)
+  {
+    auto& siblings = m_parent->m_children;
+    siblings.erase(std::find(siblings.begin(), siblings.end(), this));
+  }
+
+  m_parent = parent;
+
+  if (parent)
+  {
+    parent->m_children.push_back(this);
+  }
+
+  refreshAncestorMask();
+}
+
+/**
+ * @brief returns the children of this object
+ */
+inline const std::vector<Object*>& Object::children() const
+{
+  return m_children;
+}
+
+/**
+ * @brief recomputes the cached ancestor mask of this object and its subtree
+ */
+inline void Object::refreshAncestorMask()
+{
+  m_ancestor_mask = m_parent ? (m_parent->m_ancestor_mask | m_parent->m_events.eventMask()) : 0;
+
+  for (Object* child : m_children)
+  {
+    child->refreshAncestorMask();
+  }
+}
+
+/**
+ * @brief propagates a listener addition into the masks of the descendants
+ *
+ * Disconnections are not propagated: a stale set bit only costs a wasted
+ * mask test, whereas a missing one would drop an emission.
+ */
+inline void Object::listenerAdded()
+{
+  for (Object* child : m_children)
+  {
+    child->refreshAncestorMask();
+  }
+}
+
+/**
+ * @brief emits a signal on this object and then on each of its ancestors
+ * @param event  a pointer to a member function representing the signal
+ * @param args   the signal arguments
+ *
+ * This is the bubbling phase of a scene-graph style propagation: the signal
+ * is delivered at this object first, then climbs towards the root. Each hop
+ * is guarded by the emitter's listener-presence mask, and the climb stops
+ * as soon as the cached ancestor mask proves that nobody above can listen.
+ */
+template<typename T, typename... Params, typename... Args>
+inline void Object::emitBubbling(void (T::*event)(Params...), Args &&...args)
+{
+  const std::uint64_t bit = EventEmitter::eventMaskBit(event);
+
+  Object* node = this;
+
+  for (;;)
+  {
+    if (node->m_events.eventMask() & bit)
+    {
+      node->m_events.emit(event, args...);
+    }
+
+    if (!node->m_parent || !(node->m_ancestor_mask & bit))
+    {
+      break; // no ancestor can have a matching listener
+    }
+
+    node = node->m_parent;
+  }
+}
+
+/**
+ * @brief emits a signal on the ancestors of this object first, root inwards
+ * @param event  a pointer to a member function representing the signal
+ * @param args   the signal arguments
+ *
+ * This is the capturing phase: the signal travels from the root of the tree
+ * down the ancestor chain and is delivered at this object last. Subtrees of
+ * the chain whose masks cannot match are skipped entirely.
+ */
+template<typename T, typename... Params, typename... Args>
+inline void Object::emitCapturing(void (T::*event)(Params...), Args &&...args)
+{
+  const std::uint64_t bit = EventEmitter::eventMaskBit(event);
+
+  if (!((m_ancestor_mask | m_events.eventMask()) & bit))
+  {
+    return;
+  }
+
+  emitCapturingHelper(bit, event, args...);
+}
+
+template<typename T, typename... Params, typename... Args>
+inline void Object::emitCapturingHelper(std::uint64_t bit, void (T::*event)(Params...), Args &...args)
+{
+  if (m_parent && ((m_parent->m_ancestor_mask | m_parent->m_events.eventMask()) & bit))
+  {
+    m_parent->emitCapturingHelper(bit, event, args...);
+  }
+
+  if (m_events.eventMask() & bit)
+  {
+    m_events.emit(event, args...);
+  }
+}
+
 #endif // OBJECT_H
\ No newline at end of file
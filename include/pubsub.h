@@ -5,8 +5,12 @@
 #ifndef PUBSUB_H
 #define PUBSUB_H
 
+#include "instrumentation.h"
+#include "thread-pool.h"
+
 #include <algorithm>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 template<typename T, typename Iter, typename... Params, typename... Args>
@@ -29,6 +33,16 @@ void notify_all(const std::vector<T*>& subscribers, void (T::*method)(Params...)
   notify_all(subscribers.begin(), subscribers.end(), method, std::forward<Args>(args)...);
 }
 
+template<typename T, typename... Params, typename... Args>
+void notify_all_parallel(ThreadPool& pool, const std::vector<T*>& subscribers, void (T::*method)(Params...), std::size_t grain, Args &&...args)
+{
+  // the arguments are shared by several chunks running concurrently, so they
+  // are passed by reference to every subscriber (no forwarding).
+  pool.parallelFor(subscribers.size(), grain, [&subscribers, method, &args...](std::size_t begin, std::size_t end) {
+    notify_all(subscribers.begin() + begin, subscribers.begin() + end, method, args...);
+  });
+}
+
 template<typename P>
 class Subscriber;
 
@@ -56,9 +70,11 @@ public:
 
   void addSubscriber(subscriber_t* sub)
   {
-    auto it = find_subscriber(sub);
+    // the index gives O(1) duplicate detection; the dense vector is what
+    // notify_all iterates, so dispatch stays a contiguous scan.
+    auto result = m_index.emplace(sub, m_subscribers.size());
 
-    if (it == m_subscribers.end())
+    if (result.second)
     {
       m_subscribers.push_back(sub);
       PubPtrSetter()(sub, this);
@@ -81,11 +97,34 @@ public:
   {
     static_assert(std::is_base_of<Subscriber<P>, subscriber_t>::value);
 
-    auto it = find_subscriber(static_cast<subscriber_t*>(sub));
+    auto it = m_index.find(static_cast<subscriber_t*>(sub));
 
-    if (it != m_subscribers.end())
+    if (it != m_index.end())
     {
-      m_subscribers.erase(it);
+      const std::size_t pos = it->second;
+      m_index.erase(it);
+
+      if (m_notify_depth > 0)
+      {
+        // a notification is in progress: removing the element would invalidate
+        // the dispatch loop, so leave a tombstone that is compacted when the
+        // outermost notify() returns.
+        m_subscribers[pos] = nullptr;
+        m_dirty = true;
+      }
+      else
+      {
+        // swap-and-pop keeps the vector dense without shifting the tail.
+        subscriber_t* last = m_subscribers.back();
+        m_subscribers.pop_back();
+
+        if (pos < m_subscribers.size())
+        {
+          m_subscribers[pos] = last;
+          m_index[last] = pos;
+        }
+      }
+
       PubPtrSetter()(static_cast<subscriber_t*>(sub), nullptr);
     }
   }
@@ -93,7 +132,77 @@ public:
   template<typename... Params, typename... Args>
   void notify(void (subscriber_t::*method)(Params...), Args &&...args)
   {
-    notify_all(m_subscribers, method, std::forward<Args>(args)...);
+    NotifyScope scope{ *this };
+
+#if defined(EVENTS_ENABLE_INSTRUMENTATION)
+    const auto start = std::chrono::steady_clock::now();
+#endif
+
+    // subscribers added during the notification are not visited, and
+    // removed ones leave null tombstones that the loop skips.
+    const std::size_t count = m_subscribers.size();
+
+    for (std::size_t i(0); i < count; ++i)
+    {
+      subscriber_t* listener = m_subscribers[i];
+
+      if (listener)
+      {
+        (listener->*method)(std::forward<Args>(args)...);
+      }
+    }
+
+#if defined(EVENTS_ENABLE_INSTRUMENTATION)
+    ++m_notify_count;
+    m_notify_latency.record(static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+#endif
+  }
+
+#if defined(EVENTS_ENABLE_INSTRUMENTATION)
+
+  // number of notify() calls, and a latency histogram of the whole fan-out.
+  // only available when the library is built with EVENTS_ENABLE_INSTRUMENTATION.
+  std::uint64_t notifyCount() const
+  {
+    return m_notify_count;
+  }
+
+  const LatencyHistogram& notifyLatency() const
+  {
+    return m_notify_latency;
+  }
+
+#endif // EVENTS_ENABLE_INSTRUMENTATION
+
+  // parallel counterpart of notify(): the subscribers are partitioned into
+  // chunks of parallelGrain() elements dispatched onto the pool, and the
+  // function returns once every subscriber has been notified. the subscriber
+  // methods are invoked concurrently and must be thread-safe.
+  template<typename... Params, typename... Args>
+  void notify_parallel(ThreadPool& pool, void (subscriber_t::*method)(Params...), Args &&...args)
+  {
+    pool.parallelFor(m_subscribers.size(), m_parallel_grain, [this, method, &args...](std::size_t begin, std::size_t end) {
+      for (std::size_t i(begin); i < end; ++i)
+      {
+        subscriber_t* listener = m_subscribers[i];
+
+        if (listener)
+        {
+          (listener->*method)(args...);
+        }
+      }
+    });
+  }
+
+  std::size_t parallelGrain() const
+  {
+    return m_parallel_grain;
+  }
+
+  void setParallelGrain(std::size_t grain)
+  {
+    m_parallel_grain = grain > 0 ? grain : 1;
   }
 
   const std::vector<subscriber_t*>& subscribers() const
@@ -104,11 +213,69 @@ public:
 protected:
   typename std::vector<subscriber_t*>::iterator find_subscriber(subscriber_t* listener)
   {
-    return std::find(m_subscribers.begin(), m_subscribers.end(), listener);
+    auto it = m_index.find(listener);
+    return it != m_index.end() ? m_subscribers.begin() + it->second : m_subscribers.end();
+  }
+
+private:
+  struct NotifyScope
+  {
+    Publisher<S>& publisher;
+
+    explicit NotifyScope(Publisher<S>& p)
+      : publisher(p)
+    {
+      ++publisher.m_notify_depth;
+    }
+
+    ~NotifyScope()
+    {
+      if (--publisher.m_notify_depth == 0 && publisher.m_dirty)
+      {
+        publisher.compact();
+      }
+    }
+  };
+
+  void compact()
+  {
+    // erases the tombstones left by removeSubscriber() during a notification,
+    // updating the recorded position of every subscriber that shifts.
+    std::size_t w = 0;
+
+    for (std::size_t r(0); r < m_subscribers.size(); ++r)
+    {
+      subscriber_t* s = m_subscribers[r];
+
+      if (!s)
+      {
+        continue;
+      }
+
+      if (w != r)
+      {
+        m_subscribers[w] = s;
+        m_index[s] = w;
+      }
+
+      ++w;
+    }
+
+    m_subscribers.resize(w);
+    m_dirty = false;
   }
 
 private:
   std::vector<subscriber_t*> m_subscribers;
+  std::unordered_map<subscriber_t*, std::size_t> m_index; // position of each subscriber in m_subscribers
+  std::size_t m_parallel_grain = 64;
+  int m_notify_depth = 0;
+  bool m_dirty = false; // whether m_subscribers contains tombstones
+
+#if defined(EVENTS_ENABLE_INSTRUMENTATION)
+  std::uint64_t m_notify_count = 0;
+  LatencyHistogram m_notify_latency;
+#endif
 };
 
 template<typename P>
@@ -0,0 +1,190 @@
+// Copyright (C) 2023 Vincent Chambrin
+// This file is part of the 'events' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef SIGNAL_H
+#define SIGNAL_H
+
+#include "callback.h"
+#include "event-emitter.h"
+
+#include <vector>
+
+/**
+ * \brief a typed signal with a fixed argument list
+ *
+ * Signal is the fast-path alternative to EventEmitter for hot loops: the
+ * argument list is part of the type, so there is no event key, no bucket
+ * lookup and no virtual listener node — emitting is a plain loop over a
+ * dense vector of callbacks, and a single-listener signal boils down to one
+ * indirect call.
+ *
+ * The price is that each signal is a distinct member object of its owner
+ * (much like a Qt signal), whereas an EventEmitter multiplexes any number
+ * of events. Both can be mixed freely; forwardTo() bridges a Signal into an
+ * EventEmitter event for code that listens through the emitter.
+ *
+ * Disconnecting from inside an emission is supported; the vector is
+ * compacted once the outermost emission returns.
+ */
+template<typename... Args>
+class Signal
+{
+public:
+  using callback_type = Callback<void(Args...)>;
+
+  Signal() = default;
+  Signal(const Signal&) = delete;
+  Signal& operator=(const Signal&) = delete;
+
+  /**
+   * \brief connects a callback to the signal
+   * \return the id of the connection (never 0)
+   */
+  template<typename F>
+  int connect(F&& callback)
+  {
+    const int id = m_next_id++;
+    m_listeners.push_back(Listener{ id, callback_type(std::forward<F>(callback)) });
+    return id;
+  }
+
+  /**
+   * \brief connects a member function of an object to the signal
+   *
+   * \overload
+   */
+  template<typename T, typename... Params>
+  int connect(T* object, void (T::*method)(Params...))
+  {
+    return connect([object, method](Args... args) {
+      (object->*method)(std::forward<Args>(args)...);
+    });
+  }
+
+  /**
+   * \brief disconnects a callback
+   * \param id  the id returned by connect()
+   * \return whether a connection was actually removed
+   */
+  bool disconnect(int id)
+  {
+    for (Listener& listener : m_listeners)
+    {
+      if (listener.id == id && listener.callback)
+      {
+        if (m_emit_depth > 0)
+        {
+          // an emission is in progress: just empty the callback so the loop
+          // stays valid, and compact once the outermost emission returns.
+          listener.callback.reset();
+          m_dirty = true;
+        }
+        else
+        {
+          listener = std::move(m_listeners.back());
+          m_listeners.pop_back();
+        }
+
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /**
+   * \brief returns the number of connected callbacks
+   */
+  std::size_t listenerCount() const
+  {
+    return m_listeners.size();
+  }
+
+  /**
+   * \brief emits the signal
+   *
+   * Listeners connected during the emission are not invoked by it.
+   */
+  void operator()(Args... args)
+  {
+    if (m_listeners.empty())
+    {
+      return;
+    }
+
+    ++m_emit_depth;
+
+    const std::size_t count = m_listeners.size();
+
+    for (std::size_t i(0); i < count; ++i)
+    {
+      if (m_listeners[i].callback)
+      {
+        m_listeners[i].callback(args...);
+      }
+    }
+
+    if (--m_emit_depth == 0 && m_dirty)
+    {
+      compact();
+    }
+  }
+
+  /**
+   * \brief forwards every emission of this signal to an emitter event
+   * \param emitter  the emitter on which the event is re-emitted
+   * \param event    a pointer to a member function identifying the event
+   * \return the id of the connection, usable with disconnect()
+   *
+   * This is the interop bridge with EventEmitter: code that listens through
+   * the emitter observes the signal without knowing about it. The emitter
+   * must outlive the connection.
+   */
+  template<typename T, typename... Params>
+  int forwardTo(EventEmitter& emitter, void (T::*event)(Params...))
+  {
+    return connect([&emitter, event](Args... args) {
+      emitter.emit(event, std::forward<Args>(args)...);
+    });
+  }
+
+private:
+  struct Listener
+  {
+    int id;
+    callback_type callback;
+  };
+
+  /**
+   * \brief erases the emptied slots left by disconnect() during an emission
+   */
+  void compact()
+  {
+    std::size_t w = 0;
+
+    for (std::size_t r(0); r < m_listeners.size(); ++r)
+    {
+      if (m_listeners[r].callback)
+      {
+        if (w != r)
+        {
+          m_listeners[w] = std::move(m_listeners[r]);
+        }
+
+        ++w;
+      }
+    }
+
+    m_listeners.resize(w);
+    m_dirty = false;
+  }
+
+private:
+  std::vector<Listener> m_listeners;
+  int m_next_id = 1;
+  int m_emit_depth = 0;
+  bool m_dirty = false;
+};
+
+#endif // SIGNAL_H
@@ -0,0 +1,178 @@
+// Copyright (C) 2023 Vincent Chambrin
+// This file is part of the 'events' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef EVENTS_THREAD_POOL_H
+#define EVENTS_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief a pool of worker threads for parallel fan-out
+ *
+ * The main entry point is parallelFor(), which partitions an index range
+ * into chunks executed by the workers (and the calling thread). Chunks are
+ * claimed dynamically through an atomic counter, so a slow chunk does not
+ * leave the other workers idle.
+ */
+class ThreadPool
+{
+public:
+  /**
+   * \brief constructs a pool
+   * \param thread_count  the number of worker threads
+   */
+  explicit ThreadPool(std::size_t thread_count = std::thread::hardware_concurrency())
+  {
+    if (thread_count == 0)
+      thread_count = 1;
+
+    for (std::size_t i(0); i < thread_count; ++i)
+    {
+      m_workers.emplace_back([this]() { workerLoop(); });
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_done = true;
+    }
+
+    m_cv.notify_all();
+
+    for (std::thread& worker : m_workers)
+    {
+      worker.join();
+    }
+  }
+
+  /**
+   * \brief returns the number of worker threads
+   */
+  std::size_t threadCount() const
+  {
+    return m_workers.size();
+  }
+
+  /**
+   * \brief runs \a fn over the range [0, count) in parallel
+   * \param count  the number of indices
+   * \param grain  the chunk size (number of indices claimed at a time)
+   * \param fn     a callable invoked as fn(begin, end) for each chunk
+   *
+   * The calling thread participates in the work and the function returns
+   * once the whole range has been processed. \a fn is invoked concurrently
+   * from several threads and must be thread-safe.
+   */
+  template<typename F>
+  void parallelFor(std::size_t count, std::size_t grain, F&& fn)
+  {
+    if (count == 0)
+    {
+      return;
+    }
+
+    if (grain == 0)
+    {
+      grain = 1;
+    }
+
+    const std::size_t nchunks = (count + grain - 1) / grain;
+    const std::size_t nhelpers = std::min(threadCount(), nchunks - 1);
+
+    auto state = std::make_shared<ForState>();
+    state->pending = nhelpers;
+
+    auto work = [state, count, grain, &fn]() {
+      for (;;)
+      {
+        const std::size_t begin = state->next.fetch_add(grain, std::memory_order_relaxed);
+
+        if (begin >= count)
+        {
+          break;
+        }
+
+        fn(begin, std::min(begin + grain, count));
+      }
+    };
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+
+      for (std::size_t i(0); i < nhelpers; ++i)
+      {
+        m_tasks.push_back([state, work]() {
+          work();
+
+          {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            --state->pending;
+          }
+
+          state->cv.notify_one();
+        });
+      }
+    }
+
+    m_cv.notify_all();
+
+    work();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&state]() { return state->pending == 0; });
+  }
+
+private:
+  struct ForState
+  {
+    std::atomic<std::size_t> next{0};
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::size_t pending = 0;
+  };
+
+  void workerLoop()
+  {
+    for (;;)
+    {
+      std::function<void()> task;
+
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this]() { return m_done || !m_tasks.empty(); });
+
+        if (m_tasks.empty())
+        {
+          // m_done is necessarily true
+          return;
+        }
+
+        task = std::move(m_tasks.back());
+        m_tasks.pop_back();
+      }
+
+      task();
+    }
+  }
+
+private:
+  std::vector<std::thread> m_workers;
+  std::vector<std::function<void()>> m_tasks;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  bool m_done = false;
+};
+
+#endif // EVENTS_THREAD_POOL_H
@@ -0,0 +1,467 @@
+// Copyright (C) 2023 Vincent Chambrin
+// This file is part of the 'events' project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include "callback.h"
+#include "event-emitter.h"
+
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+/**
+ * \brief a hierarchical timing wheel for deferred and periodic emissions
+ *
+ * Timers live in a slot-map (like the listeners of an EventEmitter) and are
+ * linked into the slots of a four-level wheel, so scheduling and cancelling
+ * are both O(1) — a list insertion, no heap allocation beyond the callback
+ * state and the slot-map growth.
+ *
+ * The wheel is driven manually: advance() converts elapsed wall time into
+ * ticks and processes the expired slots in batch, invoking the callbacks of
+ * the due timers. Timers further away than the wheel's horizon are parked in
+ * the top level and cascade down as time passes.
+ *
+ * emitAfter() and emitEvery() are convenience wrappers scheduling an
+ * EventEmitter::emit() with a copy of the arguments.
+ */
+class TimerWheel
+{
+public:
+  using Invocation = Callback<void(), 6 * sizeof(void*)>;
+
+  /**
+   * \brief constructs a wheel
+   * \param tick  the duration of one tick (the scheduling granularity)
+   */
+  explicit TimerWheel(std::chrono::nanoseconds tick = std::chrono::milliseconds(1))
+    : m_tick_duration(tick.count() > 0 ? tick : std::chrono::nanoseconds(1))
+  {
+    m_slots.fill(-1);
+  }
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  /**
+   * \brief schedules a callback
+   * \param delay     time until the invocation, rounded up to a whole tick
+   * \param callback  the callback
+   * \param period    repetition period (zero for a one-shot timer)
+   * \return the id of the timer
+   *
+   * The value 0 is never a valid timer id.
+   */
+  int schedule(std::chrono::nanoseconds delay, Invocation callback, std::chrono::nanoseconds period = std::chrono::nanoseconds(0))
+  {
+    const int index = acquireTimer();
+    Timer& timer = m_timers[index];
+
+    timer.callback = std::move(callback);
+    timer.expiry = m_now + ticksFor(delay);
+    timer.period = period.count() > 0 ? ticksFor(period) : 0;
+
+    link(index);
+
+    return timerId(index, timer.generation);
+  }
+
+  /**
+   * \brief cancels a timer
+   * \param timer_id  the id of the timer
+   * \return whether a timer was actually cancelled
+   *
+   * This is O(1): the id encodes the index of the timer's slot, plus a
+   * generation counter protecting against slot reuse.
+   */
+  bool cancel(int timer_id)
+  {
+    const int index = timerIndex(timer_id);
+
+    if (index < 0 || index >= static_cast<int>(m_timers.size()))
+    {
+      return false;
+    }
+
+    Timer& timer = m_timers[index];
+
+    if (timer.slot == -1 || timerId(index, timer.generation) != timer_id)
+    {
+      return false;
+    }
+
+    if (timer.slot == PendingSlot)
+    {
+      // the timer sits in the batch step() is currently dispatching and
+      // cannot be unlinked without corrupting the walk: disarm it (the id
+      // becomes stale immediately) and let the loop free the node.
+      timer.callback.reset();
+      ++timer.generation;
+      return true;
+    }
+
+    unlink(index);
+    freeTimer(index);
+    return true;
+  }
+
+  /**
+   * \brief advances the wheel by an elapsed duration
+   * \param elapsed  the wall time that passed since the last call
+   * \return the number of timer callbacks that were invoked
+   *
+   * Sub-tick remainders are accumulated, so calling advance() with durations
+   * smaller than a tick does not lose time.
+   */
+  std::size_t advance(std::chrono::nanoseconds elapsed)
+  {
+    m_pending_ns += elapsed.count();
+
+    const std::int64_t tick_ns = m_tick_duration.count();
+    std::size_t fired = 0;
+
+    while (m_pending_ns >= tick_ns)
+    {
+      m_pending_ns -= tick_ns;
+      fired += step();
+    }
+
+    return fired;
+  }
+
+  /**
+   * \brief returns the number of ticks processed so far
+   */
+  std::uint64_t now() const
+  {
+    return m_now;
+  }
+
+  /**
+   * \brief returns the duration of one tick
+   */
+  std::chrono::nanoseconds tickDuration() const
+  {
+    return m_tick_duration;
+  }
+
+  /**
+   * \brief schedules a one-shot emission of an event
+   * \param emitter  the emitter on which the event is fired
+   * \param event    a pointer to a member function identifying the event
+   * \param delay    time until the emission
+   * \param args     event data, copied into the timer
+   * \return the id of the timer
+   *
+   * The emitter must outlive the timer (or the timer must be cancelled
+   * first).
+   */
+  template<typename T, typename... Params, typename... Args>
+  int emitAfter(EventEmitter& emitter, void (T::*event)(Params...), std::chrono::nanoseconds delay, Args&&... args)
+  {
+    return schedule(delay, makeEmitInvocation(emitter, event, std::forward<Args>(args)...));
+  }
+
+  /**
+   * \brief schedules a periodic emission of an event
+   * \param emitter  the emitter on which the event is fired
+   * \param event    a pointer to a member function identifying the event
+   * \param period   time between emissions (the first one is a period away)
+   * \param args     event data, copied into the timer
+   * \return the id of the timer
+   */
+  template<typename T, typename... Params, typename... Args>
+  int emitEvery(EventEmitter& emitter, void (T::*event)(Params...), std::chrono::nanoseconds period, Args&&... args)
+  {
+    return schedule(period, makeEmitInvocation(emitter, event, std::forward<Args>(args)...), period);
+  }
+
+private:
+  static constexpr int Levels = 4;
+  static constexpr int SlotBits = 6;
+  static constexpr int SlotsPerLevel = 1 << SlotBits;
+
+  /**
+   * \brief sentinel slot of the timers in the batch being dispatched
+   *
+   * The due list is detached from the wheel as a whole; its timers are no
+   * longer reachable from m_slots but not freed either, and cancel() must
+   * treat them specially (see the disarming path).
+   */
+  static constexpr int PendingSlot = -2;
+
+  /**
+   * \brief a timer of the slot-map
+   *
+   * Like a listener slot, a timer is either scheduled (linked into a wheel
+   * slot) or free, in which case \a next chains the free list. The
+   * generation counter invalidates stale timer ids in O(1).
+   */
+  struct Timer
+  {
+    Invocation callback;
+    std::uint64_t expiry = 0; // absolute tick of the next invocation
+    std::uint64_t period = 0; // in ticks; 0 for a one-shot timer
+    std::uint32_t generation = 0;
+    int slot = -1;            // wheel slot the timer is linked in, or -1
+    int prev = -1;
+    int next = -1;
+  };
+
+  // Timer ids are packed like connection ids: a slot index (+1, so that
+  // valid ids are never 0) and the low bits of the generation counter. The
+  // index field caps the number of simultaneously live timers at 2^20 - 1;
+  // acquireTimer() asserts on overflow, as a larger index would silently
+  // bleed into the generation bits and alias other timer ids.
+  static constexpr int TimerIndexBits = 20;
+  static constexpr std::uint32_t TimerGenerationMask = 0x7FF;
+
+  static int timerId(int index, std::uint32_t generation)
+  {
+    return static_cast<int>(((generation & TimerGenerationMask) << TimerIndexBits) | static_cast<std::uint32_t>(index + 1));
+  }
+
+  static int timerIndex(int timer_id)
+  {
+    return static_cast<int>(static_cast<std::uint32_t>(timer_id) & ((1u << TimerIndexBits) - 1)) - 1;
+  }
+
+  std::uint64_t ticksFor(std::chrono::nanoseconds duration) const
+  {
+    const std::int64_t ns = duration.count() > 0 ? duration.count() : 0;
+    const std::int64_t tick_ns = m_tick_duration.count();
+    return static_cast<std::uint64_t>((ns + tick_ns - 1) / tick_ns);
+  }
+
+  int acquireTimer()
+  {
+    if (m_free_timer != -1)
+    {
+      int index = m_free_timer;
+      m_free_timer = m_timers[index].next;
+      m_timers[index].next = -1;
+      return index;
+    }
+    else
+    {
+      // the new index (+1) must fit in the index field of a timer id
+      assert(m_timers.size() < (1u << TimerIndexBits) - 1);
+
+      m_timers.emplace_back();
+      return static_cast<int>(m_timers.size()) - 1;
+    }
+  }
+
+  void freeTimer(int index)
+  {
+    Timer& timer = m_timers[index];
+    timer.callback.reset();
+    timer.slot = -1;
+    timer.prev = -1;
+    ++timer.generation;
+    timer.next = m_free_timer;
+    m_free_timer = index;
+  }
+
+  /**
+   * \brief links a timer into the wheel slot matching its expiry
+   *
+   * The level is the lowest one whose slot width can still resolve the
+   * remaining delay; timers beyond the horizon go into the top level and
+   * cascade closer as the wheel turns.
+   */
+  void link(int index)
+  {
+    Timer& timer = m_timers[index];
+
+    const std::uint64_t delta = timer.expiry > m_now ? timer.expiry - m_now : 1;
+
+    int level = 0;
+
+    while (level < Levels - 1 && (delta >> (SlotBits * (level + 1))) != 0)
+    {
+      ++level;
+    }
+
+    const std::uint64_t expiry = timer.expiry > m_now ? timer.expiry : m_now + 1;
+    const int slot = level * SlotsPerLevel + static_cast<int>((expiry >> (SlotBits * level)) & (SlotsPerLevel - 1));
+
+    timer.slot = slot;
+    timer.prev = -1;
+    timer.next = m_slots[slot];
+
+    if (timer.next != -1)
+    {
+      m_timers[timer.next].prev = index;
+    }
+
+    m_slots[slot] = index;
+  }
+
+  void unlink(int index)
+  {
+    Timer& timer = m_timers[index];
+
+    if (timer.prev != -1)
+    {
+      m_timers[timer.prev].next = timer.next;
+    }
+    else
+    {
+      m_slots[timer.slot] = timer.next;
+    }
+
+    if (timer.next != -1)
+    {
+      m_timers[timer.next].prev = timer.prev;
+    }
+
+    timer.slot = -1;
+    timer.prev = -1;
+    timer.next = -1;
+  }
+
+  /**
+   * \brief detaches the list of a wheel slot and relinks every timer
+   *
+   * This is the cascade: when a level rolls over, the timers of the higher
+   * level's current slot are redistributed to finer levels.
+   */
+  void cascade(int slot)
+  {
+    int i = m_slots[slot];
+    m_slots[slot] = -1;
+
+    while (i != -1)
+    {
+      const int next = m_timers[i].next;
+      m_timers[i].slot = -1;
+      m_timers[i].prev = -1;
+      m_timers[i].next = -1;
+      link(i);
+      i = next;
+    }
+  }
+
+  /**
+   * \brief advances the wheel by one tick and fires the due timers
+   */
+  std::size_t step()
+  {
+    ++m_now;
+
+    // cascade the higher levels on rollover, coarsest first so that a timer
+    // can sink through several levels in one tick.
+    for (int level = Levels - 1; level >= 1; --level)
+    {
+      const std::uint64_t mask = (std::uint64_t(1) << (SlotBits * level)) - 1;
+
+      if ((m_now & mask) == 0)
+      {
+        cascade(level * SlotsPerLevel + static_cast<int>((m_now >> (SlotBits * level)) & (SlotsPerLevel - 1)));
+      }
+    }
+
+    // detach the due list as a batch; callbacks may schedule new timers
+    // into this very slot without being visited this tick.
+    const int due_slot = static_cast<int>(m_now & (SlotsPerLevel - 1));
+
+    int i = m_slots[due_slot];
+    m_slots[due_slot] = -1;
+
+    // mark the batch so that cancel() disarms its members instead of
+    // freeing them out from under the walk below.
+    for (int j = i; j != -1; j = m_timers[j].next)
+    {
+      m_timers[j].slot = PendingSlot;
+    }
+
+    std::size_t fired = 0;
+
+    while (i != -1)
+    {
+      const int next = m_timers[i].next;
+      Timer& timer = m_timers[i];
+      timer.slot = -1;
+      timer.prev = -1;
+      timer.next = -1;
+
+      if (!timer.callback)
+      {
+        // disarmed by a callback invoked earlier in this batch
+        freeTimer(i);
+      }
+      else if (timer.expiry > m_now)
+      {
+        // not due yet: the slot is shared by several expiry ticks at this
+        // wheel position, put the timer back where it belongs.
+        link(i);
+      }
+      else if (timer.period != 0)
+      {
+        // rearm before invoking so that the callback can cancel the timer.
+        timer.expiry = m_now + timer.period;
+        link(i);
+
+        // invoke from a local, as in the one-shot branch: the callback may
+        // schedule a timer (growing m_timers and freeing the slot's storage)
+        // or cancel this very timer (resetting its callback).
+        const std::uint32_t generation = timer.generation;
+        Invocation callback = std::move(timer.callback);
+        callback();
+        ++fired;
+
+        Timer& rearmed = m_timers[i];
+
+        if (rearmed.slot != -1 && rearmed.generation == generation)
+        {
+          // still alive (not cancelled, slot not reused): restore the
+          // callback for the next period.
+          rearmed.callback = std::move(callback);
+        }
+      }
+      else
+      {
+        // free the slot before invoking: the id becomes stale and the slot
+        // can be reused by a timer scheduled from within the callback.
+        Invocation callback = std::move(timer.callback);
+        freeTimer(i);
+        callback();
+        ++fired;
+      }
+
+      i = next;
+    }
+
+    return fired;
+  }
+
+  /**
+   * \brief wraps an emit into an invocation, copying the arguments
+   */
+  template<typename T, typename... Params, typename... Args>
+  static Invocation makeEmitInvocation(EventEmitter& emitter, void (T::*event)(Params...), Args&&... args)
+  {
+    return Invocation([&emitter, event, payload = std::make_tuple(std::decay_t<Args>(std::forward<Args>(args))...)]() mutable {
+      std::apply([&](auto&... unpacked) {
+        emitter.emit(event, unpacked...);
+      }, payload);
+    });
+  }
+
+private:
+  std::chrono::nanoseconds m_tick_duration;
+  std::int64_t m_pending_ns = 0;
+  std::uint64_t m_now = 0;
+  std::vector<Timer> m_timers;
+  int m_free_timer = -1;
+  std::array<int, Levels * SlotsPerLevel> m_slots;
+};
+
+#endif // TIMER_WHEEL_H
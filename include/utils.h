@@ -65,4 +65,40 @@ void invoke_relaxed(F&& f, Args&&...args)
   apply_relaxed(std::forward<F>(f), std::forward_as_tuple(std::forward<Args>(args)...));
 }
 
+template<typename F, typename Tuple, std::size_t... I>
+decltype(auto) apply_relaxed_r_impl(F&& f, Tuple&& t, std::index_sequence<I...>)
+{
+  // Same element-dropping strategy as apply_relaxed_impl(), except that the
+  // result of the call is returned to the caller.
+
+  if constexpr(sizeof...(I) == 0)
+  {
+    return f();
+  }
+  else if constexpr(std::is_invocable<F, std::tuple_element_t<I, Tuple>...>::value)
+  {
+    return std::invoke(std::forward<F>(f), std::get<I>(std::forward<Tuple>(t))...);
+  }
+  else
+  {
+    return apply_relaxed_r_impl(std::forward<F>(f), std::forward<Tuple>(t), std::make_index_sequence<sizeof...(I) - 1>());
+  }
+}
+
+/**
+ * @brief invoke a callable using the provided arguments and return the result
+ * @param f     a callable object
+ * @param args  the arguments to use (provided as a parameter pack)
+ *
+ * This is invoke_relaxed(), except that the result of the call is forwarded
+ * to the caller; it is used where the callable is a predicate.
+ *
+ * @sa invoke_relaxed().
+ */
+template<typename F, typename ...Args>
+decltype(auto) invoke_relaxed_r(F&& f, Args&&...args)
+{
+  return apply_relaxed_r_impl(std::forward<F>(f), std::forward_as_tuple(std::forward<Args>(args)...), std::make_index_sequence<sizeof...(Args)>());
+}
+
 #endif // EVENTS_UTILS_H
\ No newline at end of file
@@ -6,5 +6,17 @@
 
 Object::~Object()
 {
-  m_connection_list.clear();
+  if (m_parent)
+  {
+    auto& siblings = m_parent->m_children;
+    siblings.erase(std::find(siblings.begin(), siblings.end(), this));
+  }
+
+  for (Object* child : m_children)
+  {
+    child->m_parent = nullptr;
+    child->refreshAncestorMask();
+  }
+
+  m_connection_list.disconnectAll();
 }
@@ -2,11 +2,20 @@
 // This file is part of the 'events' project.
 // For conditions of distribution and use, see copyright notice in LICENSE.
 
+#include "awaitable-event.h"
+#include "concurrent-event-emitter.h"
+#include "event-bus.h"
 #include "event-emitter.h"
+#include "event-journal.h"
 #include "object.h"
 #include "pubsub.h"
+#include "signal.h"
+#include "timer-wheel.h"
 
+#include <atomic>
+#include <cstdio>
 #include <iostream>
+#include <thread>
 
 #define REQUIRE(x) test_require(x, #x, __FILE__, __LINE__)
 
@@ -120,6 +129,86 @@ void test_disconnect()
   REQUIRE(m == 3 && a.n() == 4);
 }
 
+void test_stale_connection_id()
+{
+  // The goal of this test is to verify that the id of a removed connection
+  // cannot accidentally remove a listener that later reused its slot.
+
+  MyClass a;
+
+  int n = 0;
+  int p = 0;
+
+  ConnectionData first = a.on(&MyClass::nChanged, [&n](int val){
+    n = val;
+  });
+
+  REQUIRE(a.removeListener(first.connection_id));
+  REQUIRE(!a.removeListener(first.connection_id));
+
+  // this listener reuses the slot of the first one, but gets a different id
+  ConnectionData second = a.on(&MyClass::nChanged, [&p](int val){
+    p = val;
+  });
+
+  REQUIRE(second.connection_id != first.connection_id);
+  REQUIRE(!a.removeListener(first.connection_id));
+
+  a.setN(3);
+  REQUIRE(n == 0 && p == 3);
+}
+
+void test_bulk_disconnect()
+{
+  // The goal of this test is to verify that a batch of connections can be
+  // removed in one call, and that stale ids in the batch are skipped.
+
+  MyClass a;
+
+  int n = 0;
+  std::vector<int> ids;
+
+  for (int i = 0; i < 10; ++i)
+  {
+    ids.push_back(a.on(&MyClass::nChanged, [&n](int){ ++n; }).connection_id);
+  }
+
+  a.setN(1);
+  REQUIRE(n == 10);
+
+  REQUIRE(a.removeListeners(ids.data(), ids.size()) == 10);
+
+  a.setN(2);
+  REQUIRE(n == 10);
+
+  REQUIRE(a.removeListeners(ids.data(), ids.size()) == 0);
+}
+
+void test_lifetime_token()
+{
+  // The goal of this test is to verify that a ConnectionHandle correctly
+  // detects the destruction of its emitter, even when another emitter is
+  // created afterwards (and possibly reuses the same registry slot).
+
+  ConnectionHandle handle;
+
+  {
+    MyClass a;
+
+    handle = ConnectionHandle(a.on(&MyClass::nChanged, [](int){}));
+    REQUIRE(handle.isValid());
+    REQUIRE(handle.eventEmitter() == &a);
+  }
+
+  REQUIRE(!handle.isValid());
+  REQUIRE(handle.eventEmitter() == nullptr);
+
+  MyClass b;
+  REQUIRE(!handle.isValid());
+
+  handle.disconnect(); // must be a safe no-op
+}
+
 void test_two_events()
 {
   // The goal of this test is to verify that multiple events with 
@@ -151,6 +240,100 @@ void test_two_events()
   REQUIRE(n == 4 && p == 6);
 }
 
+void test_listener_priorities()
+{
+  // The goal of this test is to verify that listeners are invoked in
+  // priority order (lower tiers first), in registration order within a tier.
+
+  MyClass a;
+
+  std::vector<int> order;
+
+  a.on(&MyClass::nChanged, [&order](int){ order.push_back(1); }, 1);
+  a.on(&MyClass::nChanged, [&order](int){ order.push_back(0); }, 0);
+  a.on(&MyClass::nChanged, [&order](int){ order.push_back(2); }, 1);
+  a.on(&MyClass::nChanged, [&order](int){ order.push_back(3); }); // default tier 0
+
+  a.setN(1);
+
+  REQUIRE(order.size() == 4);
+  REQUIRE(order[0] == 0 && order[1] == 3 && order[2] == 1 && order[3] == 2);
+
+  // a listener registered mid-emit is not invoked by the in-flight emit,
+  // even when its tier inserts it inside the span being traversed
+  MyClass b;
+  std::vector<int> seen;
+  bool registered = false;
+
+  b.on(&MyClass::nChanged, [&](int){
+    seen.push_back(0);
+
+    if (!registered)
+    {
+      registered = true;
+      b.on(&MyClass::nChanged, [&seen](int){ seen.push_back(5); }, 5);
+    }
+  }, 0);
+  b.on(&MyClass::nChanged, [&seen](int){ seen.push_back(10); }, 10);
+
+  b.setN(1);
+  REQUIRE(seen.size() == 2);
+  REQUIRE(seen[0] == 0 && seen[1] == 10);
+
+  b.setN(2); // the next emit sees the new listener, in tier order
+  REQUIRE(seen.size() == 5);
+  REQUIRE(seen[2] == 0 && seen[3] == 5 && seen[4] == 10);
+}
+
+void test_reentrant_emit()
+{
+  // The goal of this test is to verify that listeners can be added and
+  // removed (including from inside a callback) while an emit is in
+  // progress, without invalidating the dispatch loop.
+
+  MyClass a;
+
+  int b_calls = 0;
+  int c_calls = 0;
+
+  ConnectionData b{};
+
+  // listener A removes listener B during dispatch: B must not be invoked.
+  a.on(&MyClass::nChanged, [&a, &b](int){
+    a.removeListener(b.connection_id);
+  });
+
+  b = a.on(&MyClass::nChanged, [&b_calls](int){
+    ++b_calls;
+  });
+
+  a.setN(1);
+  REQUIRE(b_calls == 0);
+
+  // a listener registered during dispatch is not invoked by that emit...
+  a.once(&MyClass::pChanged, [&a, &c_calls](int){
+    a.on(&MyClass::pChanged, [&c_calls](int){
+      ++c_calls;
+    });
+  });
+
+  a.setP(1);
+  REQUIRE(c_calls == 0);
+
+  // ...but is invoked by the next one.
+  a.setP(2);
+  REQUIRE(c_calls == 1);
+
+  // self-removal from inside the callback is fine too
+  ConnectionData self = a.on(&MyClass::superEvent, [&a, &self](){
+    a.removeListener(self.connection_id);
+  });
+
+  a.superEvent();
+  a.superEvent();
+  REQUIRE(!a.removeListener(self.connection_id));
+}
+
 void test_once()
 {
   // The goal of this test is to verify that an event listener 
@@ -170,6 +353,229 @@ void test_once()
   REQUIRE(super == 1);
 }
 
+void test_once_burst()
+{
+  // The goal of this test is to verify that consuming a large burst of
+  // single-shot listeners is handled through deferred compaction: every
+  // listener fires exactly once, the freed slots are recycled, and a
+  // listener surviving the burst keeps working.
+
+  MyClass a;
+
+  int calls = 0;
+  std::vector<int> ids;
+
+  for (int i = 0; i < 10000; ++i)
+  {
+    ids.push_back(a.once(&MyClass::superEvent, [&calls]() { ++calls; }).connection_id);
+  }
+
+  int persistent = 0;
+  a.on(&MyClass::superEvent, [&persistent]() { ++persistent; });
+
+  a.superEvent();
+  REQUIRE(calls == 10000);
+  REQUIRE(persistent == 1);
+
+  // the burst is fully consumed: all its ids are stale now
+  for (int id : ids)
+  {
+    REQUIRE(!a.removeListener(id));
+  }
+
+  a.superEvent();
+  REQUIRE(calls == 10000);
+  REQUIRE(persistent == 2);
+}
+
+void test_compile_time_events()
+{
+  // The goal of this test is to verify that the template<auto Event>
+  // overloads of on(), once() and emit() behave like their runtime
+  // counterparts (and mix well with them).
+
+  MyClass a;
+
+  int n = 0;
+  int super = 0;
+
+  a.on<&MyClass::nChanged>([&n](int val){
+    n = val;
+  });
+
+  a.once<&MyClass::superEvent>([&super](){
+    ++super;
+  });
+
+  a.emit<&MyClass::nChanged>(5);
+  REQUIRE(n == 5);
+
+  a.setN(7); // goes through the runtime emit()
+  REQUIRE(n == 7);
+
+  a.emit<&MyClass::superEvent>();
+  a.emit<&MyClass::superEvent>();
+  REQUIRE(super == 1);
+}
+
+void test_callback()
+{
+  // The goal of this test is to verify the basic operations of the
+  // Callback class (small captures stored inline, big captures on
+  // the heap, move semantics).
+
+  int n = 0;
+
+  Callback<void(int)> small{[&n](int val) { n += val; }};
+  REQUIRE(static_cast<bool>(small));
+  small(2);
+  REQUIRE(n == 2);
+
+  Callback<void(int)> moved = std::move(small);
+  REQUIRE(!small);
+  moved(3);
+  REQUIRE(n == 5);
+
+  // a capture bigger than the inline capacity goes through the heap path
+  struct BigCapture { long long a, b, c, d, e; };
+  BigCapture big{1, 2, 3, 4, 5};
+
+  Callback<void(int)> bigcb{[&n, big](int val) { n += val + static_cast<int>(big.e); }};
+  bigcb(1);
+  REQUIRE(n == 11);
+
+  bigcb.reset();
+  REQUIRE(!bigcb);
+}
+
+void test_listener_arena()
+{
+  // The goal of this test is to verify that an emitter with an installed
+  // arena behaves like a regular emitter (connect, emit, disconnect).
+
+  Arena arena;
+  MyClass a;
+  a.setListenerArena(&arena);
+
+  int n = 0;
+
+  for (int i = 0; i < 100; ++i)
+  {
+    ConnectionHandle handle = a.on(&MyClass::nChanged, [&n](int val){
+      n += val;
+    });
+
+    a.setN(i + 1);
+  }
+
+  REQUIRE(n == 5050);
+  REQUIRE(a.listenerArena() == &arena);
+
+  a.setListenerArena(nullptr);
+  a.on(&MyClass::nChanged, [&n](int val){
+    n = val;
+  });
+  a.setN(1);
+  REQUIRE(n == 1);
+}
+
+struct Payload
+{
+  static int constructions;
+  static int copies;
+
+  int value;
+
+  Payload(int v) : value(v) { ++constructions; }
+  Payload(const Payload& other) : value(other.value) { ++copies; }
+};
+
+int Payload::constructions = 0;
+int Payload::copies = 0;
+
+void test_borrowed_arguments()
+{
+  // The goal of this test is to verify that emitting an event copies (or
+  // materializes) its arguments at most once, regardless of the number of
+  // listeners: listeners borrow references into the emit's argument frame.
+
+  struct PayloadEE : EventEmitter
+  {
+    void payloadReady(const Payload& p) {
+      emit(&PayloadEE::payloadReady, p);
+    }
+  };
+
+  PayloadEE ee;
+
+  int total = 0;
+
+  for (int i = 0; i < 3; ++i)
+  {
+    ee.on(&PayloadEE::payloadReady, [&total](const Payload& p){
+      total += p.value;
+    });
+  }
+
+  Payload payload{7};
+  Payload::constructions = 0;
+  Payload::copies = 0;
+
+  ee.payloadReady(payload);
+  REQUIRE(total == 21);
+  REQUIRE(Payload::constructions == 0 && Payload::copies == 0);
+
+  // when a conversion is needed, the argument is materialized once for
+  // the whole emit, not once per listener.
+  ee.emit(&PayloadEE::payloadReady, 5);
+  REQUIRE(total == 36);
+  REQUIRE(Payload::constructions == 1 && Payload::copies == 0);
+}
+
+void test_emit_batch()
+{
+  // The goal of this test is to verify that emitBatch() delivers every
+  // payload of the range to the listeners, and that tuple payloads are
+  // expanded into the argument list.
+
+  MyClass a;
+
+  int total = 0;
+  int once_value = 0;
+
+  a.on(&MyClass::nChanged, [&total](int val){
+    total += val;
+  });
+
+  a.once(&MyClass::nChanged, [&once_value](int val){
+    once_value = val;
+  });
+
+  std::vector<int> payloads = {1, 2, 3, 4};
+  a.emitBatch(&MyClass::nChanged, payloads);
+
+  REQUIRE(total == 10);
+  REQUIRE(once_value == 1); // the once-listener only saw the first payload
+
+  struct PairEE : EventEmitter
+  {
+    void twoArgs(int, int) {}
+  };
+
+  PairEE ee;
+
+  int sum = 0;
+
+  ee.on(&PairEE::twoArgs, [&sum](int x, int y){
+    sum += x * y;
+  });
+
+  std::vector<std::tuple<int, int>> pairs = {{1, 2}, {3, 4}};
+  ee.emitBatch(&PairEE::twoArgs, pairs.begin(), pairs.end());
+
+  REQUIRE(sum == 14);
+}
+
 void test_partial_args()
 {
   // The goal of this test is to verify that an event listener 
@@ -199,6 +605,59 @@ void test_partial_args()
   REQUIRE(total == (1+2+1));
 }
 
+class Counter
+{
+public:
+  void incremented(int) { }
+  void done() { }
+};
+
+void test_concurrent_emitter()
+{
+  // The goal of this test is to verify that ConcurrentEventEmitter supports
+  // concurrent emissions and that once() listeners fire exactly once even
+  // when the event is emitted from several threads.
+
+  ConcurrentEventEmitter emitter;
+
+  std::atomic<int> total{0};
+  std::atomic<int> once_count{0};
+
+  int id = emitter.on(&Counter::incremented, [&total](int n){
+    total += n;
+  });
+
+  emitter.once(&Counter::done, [&once_count](){
+    ++once_count;
+  });
+
+  std::vector<std::thread> threads;
+
+  for (int t = 0; t < 4; ++t)
+  {
+    threads.emplace_back([&emitter]() {
+      for (int i = 0; i < 1000; ++i)
+      {
+        emitter.emit(&Counter::incremented, 1);
+      }
+
+      emitter.emit(&Counter::done);
+    });
+  }
+
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
+
+  REQUIRE(total == 4000);
+  REQUIRE(once_count == 1);
+
+  REQUIRE(emitter.removeListener(id));
+  emitter.emit(&Counter::incremented, 1);
+  REQUIRE(total == 4000);
+}
+
 class MySubscriber;
 
 class MyPublisher : public Publisher<MySubscriber>
@@ -307,6 +766,141 @@ void test_pubsub()
   pub.greets();
 }
 
+class VolatileSubscriber;
+
+class VolatilePublisher : public Publisher<VolatileSubscriber>
+{
+
+};
+
+class VolatileSubscriber : public Subscriber<VolatilePublisher>
+{
+public:
+  int notified = 0;
+  bool remove_self = false;
+
+  void ping()
+  {
+    ++notified;
+
+    if (remove_self)
+    {
+      publisher()->removeSubscriber(this);
+    }
+  }
+};
+
+void test_reentrant_notify()
+{
+  VolatilePublisher pub;
+  VolatileSubscriber a, b, c;
+  pub.addSubscriber(&a);
+  pub.addSubscriber(&b);
+  pub.addSubscriber(&c);
+
+  b.remove_self = true;
+  pub.notify(&VolatileSubscriber::ping);
+
+  // everyone got the notification, and b is gone afterwards
+  REQUIRE(a.notified == 1);
+  REQUIRE(b.notified == 1);
+  REQUIRE(c.notified == 1);
+  REQUIRE(pub.subscribers().size() == 2);
+  REQUIRE(b.publisher() == nullptr);
+
+  pub.notify(&VolatileSubscriber::ping);
+  REQUIRE(a.notified == 2);
+  REQUIRE(b.notified == 1);
+  REQUIRE(c.notified == 2);
+}
+
+class TickSubscriber;
+
+class TickPublisher : public Publisher<TickSubscriber>
+{
+
+};
+
+class TickSubscriber : public Subscriber<TickPublisher>
+{
+public:
+  std::atomic<int> ticks{ 0 };
+
+  void tick(int amount)
+  {
+    ticks += amount;
+  }
+};
+
+void test_parallel_notify()
+{
+  ThreadPool pool{ 2 };
+
+  {
+    std::atomic<int> sum{ 0 };
+    pool.parallelFor(1000, 16, [&sum](std::size_t begin, std::size_t end) {
+      sum += static_cast<int>(end - begin);
+    });
+    REQUIRE(sum == 1000);
+  }
+
+  TickPublisher pub;
+  std::vector<TickSubscriber> subs{ 100 };
+
+  for (TickSubscriber& s : subs)
+  {
+    pub.addSubscriber(&s);
+  }
+
+  pub.setParallelGrain(8);
+  REQUIRE(pub.parallelGrain() == 8);
+
+  pub.notify_parallel(pool, &TickSubscriber::tick, 2);
+  pub.notify_parallel(pool, &TickSubscriber::tick, 3);
+
+  for (TickSubscriber& s : subs)
+  {
+    REQUIRE(s.ticks == 5);
+  }
+
+  for (TickSubscriber& s : subs)
+  {
+    pub.removeSubscriber(&s);
+  }
+}
+
+void test_emit_parallel()
+{
+  ThreadPool pool{ 2 };
+
+  MyClass object;
+  object.setParallelGrain(8);
+  REQUIRE(object.parallelGrain() == 8);
+
+  std::atomic<int> total{ 0 };
+
+  for (int i = 0; i < 100; ++i)
+  {
+    object.on(&MyClass::nChanged, [&total](int n) { total += n; });
+  }
+
+  object.once(&MyClass::nChanged, [&total](int n) { total += 1000 * n; });
+
+  object.emitParallel(pool, &MyClass::nChanged, 1);
+  REQUIRE(total == 1100);
+
+  // the single-shot listener was consumed despite the parallel path
+  object.emitParallel(pool, &MyClass::nChanged, 1);
+  REQUIRE(total == 1200);
+
+  // below the grain, the emission goes through the sequential dispatch
+  MyClass small;
+  int hits = 0;
+  small.on(&MyClass::nChanged, [&hits](int) { ++hits; });
+  small.emitParallel(pool, &MyClass::nChanged, 0);
+  REQUIRE(hits == 1);
+}
+
 class SpinBox : public Object
 {
 public:
@@ -373,16 +967,602 @@ void test_two_objects()
   REQUIRE(nopen == 1);
 }
 
+void test_conflated_connection()
+{
+  // The goal of this test is to verify that a conflating listener only
+  // sees the most recent emission, delivered at the drain point.
+
+  MyClass a;
+
+  int latest = 0;
+  int calls = 0;
+
+  a.onConflated(&MyClass::nChanged, [&latest, &calls](int val){
+    latest = val;
+    ++calls;
+  });
+
+  for (int i = 1; i <= 1000; ++i)
+  {
+    a.setN(i);
+  }
+
+  REQUIRE(calls == 0);
+
+  REQUIRE(a.flushConflated() == 1);
+  REQUIRE(latest == 1000 && calls == 1);
+
+  // nothing pending: the callback is not invoked again
+  REQUIRE(a.flushConflated() == 0);
+  REQUIRE(calls == 1);
+
+  // also exposed through Object::connect
+  SpinBox spinbox;
+  int spin_latest = 0;
+
+  Object::connect(&spinbox, &SpinBox::valueChanged, ConflatedConnection{}, [&spin_latest](int val) {
+    spin_latest = val;
+  });
+
+  spinbox.valueChanged(1);
+  spinbox.valueChanged(2);
+  REQUIRE(spin_latest == 0);
+
+  spinbox.flushConflated();
+  REQUIRE(spin_latest == 2);
+
+  // a flushed callback may register more conflating listeners (growing the
+  // table mid-flush); a reentrant flushConflated() is a no-op
+  int nested = 0;
+  a.onConflated(&MyClass::pChanged, [&a, &nested](int) {
+    a.onConflated(&MyClass::superEvent, [&nested]() { ++nested; });
+    REQUIRE(a.flushConflated() == 0);
+  });
+
+  a.setP(3);
+  REQUIRE(a.flushConflated() == 1);
+  REQUIRE(nested == 0); // the new listener was not visited by the in-flight flush
+
+  a.superEvent();
+  REQUIRE(a.flushConflated() == 1);
+  REQUIRE(nested == 1);
+}
+
+void test_queued_connection()
+{
+  // The goal of this test is to verify that a queued connection defers the
+  // invocation of the callback to the draining of the queue, including when
+  // the signal is emitted from another thread.
+
+  SpinBox spinbox;
+  EventQueue queue;
+
+  int n = 0;
+
+  Object::connect(&spinbox, &SpinBox::valueChanged, &queue, [&n](int val) {
+    n += val;
+  });
+
+  spinbox.valueChanged(3);
+  REQUIRE(n == 0); // not invoked yet
+
+  REQUIRE(queue.drain() == 1);
+  REQUIRE(n == 3);
+
+  std::thread producer([&spinbox]() {
+    for (int i = 0; i < 100; ++i)
+    {
+      spinbox.valueChanged(1);
+    }
+  });
+
+  producer.join();
+
+  queue.drain();
+  REQUIRE(n == 103);
+}
+
+class Widget : public Object
+{
+public:
+  void clicked(int id)
+  {
+    emit(&Widget::clicked, id);
+  }
+};
+
+void test_object_hierarchy()
+{
+  Widget root, panel, button;
+  panel.setParent(&root);
+  button.setParent(&panel);
+
+  REQUIRE(button.parent() == &panel);
+  REQUIRE(panel.parent() == &root);
+  REQUIRE(root.children().size() == 1);
+
+  std::vector<std::string> order;
+  Object::connect(&root, &Widget::clicked, [&order](int) { order.push_back("root"); });
+  Object::connect(&button, &Widget::clicked, [&order](int) { order.push_back("button"); });
+
+  // bubbling: target first, then up the ancestor chain (panel has no
+  // listener and is pruned by its mask)
+  button.emitBubbling(&Widget::clicked, 1);
+  REQUIRE(order.size() == 2);
+  REQUIRE(order[0] == "button");
+  REQUIRE(order[1] == "root");
+
+  // capturing: root first, target last
+  order.clear();
+  button.emitCapturing(&Widget::clicked, 2);
+  REQUIRE(order.size() == 2);
+  REQUIRE(order[0] == "root");
+  REQUIRE(order[1] == "button");
+
+  // reparenting refreshes the masks
+  button.setParent(&root);
+  REQUIRE(panel.children().empty());
+
+  order.clear();
+  button.emitBubbling(&Widget::clicked, 3);
+  REQUIRE(order.size() == 2);
+  REQUIRE(order[0] == "button");
+  REQUIRE(order[1] == "root");
+
+  // a detached object only delivers to itself
+  button.setParent(nullptr);
+  order.clear();
+  button.emitBubbling(&Widget::clicked, 4);
+  REQUIRE(order.size() == 1);
+  REQUIRE(order[0] == "button");
+}
+
+void test_named_events()
+{
+  EventEmitter emitter;
+
+  const EventName price_changed{ "priceChanged" };
+  REQUIRE(EventName("priceChanged").id() == price_changed.id()); // interning is stable
+  REQUIRE(EventName("orderFilled") != price_changed);
+
+  int total = 0;
+  ConnectionData c = emitter.onNamed<int>(price_changed, [&total](int p) { total += p; });
+
+  emitter.emitNamed(price_changed, 5);
+  REQUIRE(total == 5);
+
+  emitter.emitNamed(EventName("priceChanged"), 2); // same interned id
+  REQUIRE(total == 7);
+
+  emitter.emitNamed(EventName("orderFilled"), 3); // different event
+  REQUIRE(total == 7);
+
+  int once_hits = 0;
+  emitter.onceNamed<int>(price_changed, [&once_hits](int) { ++once_hits; });
+  emitter.emitNamed(price_changed, 1);
+  emitter.emitNamed(price_changed, 1);
+  REQUIRE(once_hits == 1);
+  REQUIRE(total == 9);
+
+  REQUIRE(emitter.removeListener(c.connection_id));
+  emitter.emitNamed(price_changed, 4);
+  REQUIRE(total == 9);
+}
+
+// topics of the event bus; the class is never instantiated, its member
+// functions merely name the topics.
+class BusTopics
+{
+public:
+  void tick(int) {}
+  void message(int) {}
+};
+
+void test_event_bus()
+{
+  EventBus bus{ 2 };
+  REQUIRE(bus.shardCount() == 2);
+
+  int total = 0;
+  ConnectionData c = bus.subscribe(&BusTopics::tick, [&total](int n) { total += n; });
+
+  int once_hits = 0;
+  bus.subscribeOnce(&BusTopics::tick, [&once_hits](int) { ++once_hits; });
+
+  bus.publish(&BusTopics::tick, 2);
+  bus.publish(&BusTopics::tick, 3);
+  REQUIRE(total == 5);
+  REQUIRE(once_hits == 1);
+
+  // bus subscriptions go through the regular connection lifecycle
+  {
+    ConnectionHandle handle{ bus.subscribe(&BusTopics::message, [&total](int n) { total += 100 * n; }) };
+    bus.publish(&BusTopics::message, 1);
+    REQUIRE(total == 105);
+  }
+
+  bus.publish(&BusTopics::message, 1);
+  REQUIRE(total == 105);
+
+  REQUIRE(bus.unsubscribe(c));
+  REQUIRE(!bus.unsubscribe(c));
+  bus.publish(&BusTopics::tick, 9);
+  REQUIRE(total == 105);
+
+  // concurrent publishers to the same topic serialize on its shard
+  std::atomic<int> ticks{ 0 };
+  bus.subscribe(&BusTopics::tick, [&ticks](int) { ++ticks; });
+
+  auto publisher = [&bus]() {
+    for (int i = 0; i < 1000; ++i)
+    {
+      bus.publish(&BusTopics::tick, i);
+    }
+  };
+
+  std::thread t1{ publisher };
+  std::thread t2{ publisher };
+  t1.join();
+  t2.join();
+
+  REQUIRE(ticks == 2000);
+}
+
+void test_filtered_connections()
+{
+  MyClass object;
+
+  int odd_total = 0;
+  object.onFiltered(&MyClass::nChanged,
+    [](int n) { return n % 2 != 0; },
+    [&odd_total](int n) { odd_total += n; });
+
+  int keyed_hits = 0;
+  ConnectionData c = object.onKeyed(&MyClass::nChanged, 7, [&keyed_hits](int) { ++keyed_hits; });
+
+  for (int n : { 1, 2, 3, 7, 8 })
+  {
+    object.setN(0);
+    object.setN(n);
+  }
+
+  REQUIRE(odd_total == 1 + 3 + 7);
+  REQUIRE(keyed_hits == 1);
+
+  // the filter may take fewer parameters than the event
+  bool open = false;
+  int while_open = 0;
+  object.onFiltered(&MyClass::nChanged,
+    [&open]() { return open; },
+    [&while_open](int n) { while_open += n; });
+
+  object.setN(5);
+  REQUIRE(while_open == 0);
+  open = true;
+  object.setN(6);
+  REQUIRE(while_open == 6);
+
+  // a keyed listener disconnects like any other
+  REQUIRE(object.removeListener(c.connection_id));
+  object.setN(7);
+  REQUIRE(keyed_hits == 1);
+}
+
+void test_event_journal()
+{
+  const char* path = "test-journal.bin";
+  std::remove(path);
+
+  MyClass object;
+  int total = 0;
+  int last_p = 0;
+  object.on(&MyClass::nChanged, [&total](int n) { total += n; });
+  object.on(&MyClass::pChanged, [&last_p](int v) { last_p = v; });
+
+  {
+    EventJournal journal{ path, 4096 };
+    REQUIRE(journal.isOpen());
+
+    journal.emit(object, &MyClass::nChanged, 1);
+    journal.emit(object, &MyClass::nChanged, 2);
+    journal.emit(object, &MyClass::pChanged, 7);
+    REQUIRE(total == 3);
+    REQUIRE(last_p == 7);
+  }
+
+  {
+    // reopening preserves the records; replay is filtered by event
+    EventJournal journal{ path, 4096 };
+    REQUIRE(journal.isOpen());
+
+    REQUIRE(journal.replay(object, &MyClass::nChanged) == 2);
+    REQUIRE(total == 6);
+
+    REQUIRE(journal.replay(object, &MyClass::pChanged) == 1);
+    REQUIRE(last_p == 7);
+
+    // once the ring is full, the oldest records are overwritten
+    for (int i = 0; i < 1000; ++i)
+    {
+      journal.record(&MyClass::nChanged, 1);
+    }
+
+    total = 0;
+    const std::size_t replayed = journal.replay(object, &MyClass::nChanged);
+    REQUIRE(replayed > 0);
+    REQUIRE(replayed < 1000);
+    REQUIRE(total == static_cast<int>(replayed));
+  }
+
+  std::remove(path);
+}
+
+void test_signal()
+{
+  Signal<int> sig;
+
+  int total = 0;
+  int a = sig.connect([&total](int n) { total += n; });
+
+  MyClass object;
+  sig.connect(&object, &MyClass::setN);
+
+  sig(3);
+  REQUIRE(total == 3);
+  REQUIRE(object.n() == 3);
+
+  // disconnecting from inside an emission is safe
+  int b = 0;
+  b = sig.connect([&sig, &b, &total](int) {
+    total += 100;
+    sig.disconnect(b);
+  });
+
+  sig(1);
+  REQUIRE(total == 104);
+  REQUIRE(sig.listenerCount() == 2);
+
+  sig(1);
+  REQUIRE(total == 105);
+
+  REQUIRE(sig.disconnect(a));
+  REQUIRE(!sig.disconnect(a));
+  sig(5);
+  REQUIRE(total == 105);
+  REQUIRE(object.n() == 5);
+
+  // interop: forwarding the signal into an EventEmitter event
+  int forwarded = 0;
+  object.on(&MyClass::pChanged, [&forwarded](int v) { forwarded = v; });
+  sig.forwardTo(object, &MyClass::pChanged);
+
+  sig(9);
+  REQUIRE(forwarded == 9);
+}
+
+void test_timer_wheel()
+{
+  MyClass object;
+  TimerWheel wheel{ std::chrono::milliseconds(1) };
+
+  int total = 0;
+  object.on(&MyClass::nChanged, [&total](int n) { total += n; });
+
+  int t1 = wheel.emitAfter(object, &MyClass::nChanged, std::chrono::milliseconds(5), 10);
+  REQUIRE(t1 != 0);
+
+  REQUIRE(wheel.advance(std::chrono::milliseconds(4)) == 0);
+  REQUIRE(total == 0);
+  REQUIRE(wheel.advance(std::chrono::milliseconds(1)) == 1);
+  REQUIRE(total == 10);
+
+  // a delay beyond 64 ticks lands in a higher level and cascades down
+  wheel.emitAfter(object, &MyClass::nChanged, std::chrono::milliseconds(300), 1);
+  REQUIRE(wheel.advance(std::chrono::milliseconds(299)) == 0);
+  REQUIRE(wheel.advance(std::chrono::milliseconds(1)) == 1);
+  REQUIRE(total == 11);
+
+  // periodic emission, then cancellation
+  int psum = 0;
+  object.on(&MyClass::pChanged, [&psum](int v) { psum += v; });
+
+  int tp = wheel.emitEvery(object, &MyClass::pChanged, std::chrono::milliseconds(10), 2);
+  wheel.advance(std::chrono::milliseconds(35));
+  REQUIRE(psum == 6);
+
+  REQUIRE(wheel.cancel(tp));
+  REQUIRE(!wheel.cancel(tp)); // the id is stale now
+  wheel.advance(std::chrono::milliseconds(50));
+  REQUIRE(psum == 6);
+
+  // cancelling a one-shot timer before it expires
+  int t2 = wheel.emitAfter(object, &MyClass::nChanged, std::chrono::milliseconds(3), 100);
+  REQUIRE(wheel.cancel(t2));
+  wheel.advance(std::chrono::milliseconds(5));
+  REQUIRE(total == 11);
+
+  // sub-tick remainders accumulate instead of being lost
+  wheel.emitAfter(object, &MyClass::nChanged, std::chrono::milliseconds(1), 5);
+  REQUIRE(wheel.advance(std::chrono::microseconds(600)) == 0);
+  REQUIRE(wheel.advance(std::chrono::microseconds(600)) == 1);
+  REQUIRE(total == 16);
+
+  // a periodic callback may schedule a timer (growing the slot-map while it
+  // runs) or cancel its own timer
+  int bursts = 0;
+  int echoes = 0;
+  int self = 0;
+  int tb = wheel.schedule(std::chrono::milliseconds(2), TimerWheel::Invocation([&]() {
+    ++bursts;
+    wheel.schedule(std::chrono::milliseconds(1), TimerWheel::Invocation([&echoes]() { ++echoes; }));
+  }), std::chrono::milliseconds(2));
+  int ts = wheel.schedule(std::chrono::milliseconds(2), TimerWheel::Invocation([&]() {
+    ++self;
+    wheel.cancel(ts);
+  }), std::chrono::milliseconds(2));
+
+  wheel.advance(std::chrono::milliseconds(7));
+  REQUIRE(bursts == 3);
+  REQUIRE(echoes >= 2);
+  REQUIRE(self == 1);
+  REQUIRE(wheel.cancel(tb));
+
+  // a callback cancelling a sibling timer due in the very same tick: only
+  // the winner fires, the sibling is disarmed without corrupting the batch
+  int duels = 0;
+  int left = 0;
+  int right = 0;
+  left = wheel.schedule(std::chrono::milliseconds(1), TimerWheel::Invocation([&]() { ++duels; wheel.cancel(right); }));
+  right = wheel.schedule(std::chrono::milliseconds(1), TimerWheel::Invocation([&]() { ++duels; wheel.cancel(left); }));
+
+  REQUIRE(wheel.advance(std::chrono::milliseconds(1)) == 1);
+  REQUIRE(duels == 1);
+  REQUIRE(!wheel.cancel(left)); // both ids are stale now
+  REQUIRE(!wheel.cancel(right));
+}
+
+#if defined(EVENTS_ENABLE_INSTRUMENTATION)
+
+void test_instrumentation()
+{
+  MyClass object;
+  object.setSlowListenerThreshold(std::chrono::nanoseconds(0)); // every invocation is "slow"
+
+  int total = 0;
+  ConnectionData c = object.on(&MyClass::nChanged, [&total](int n) { total += n; });
+
+  object.setN(1);
+  object.setN(2);
+  object.emit(&MyClass::pChanged, 5); // no listeners, but the emission is still counted
+
+  EventEmitter::InstrumentationSnapshot snapshot = object.instrumentationSnapshot();
+  REQUIRE(snapshot.events.size() == 2);
+
+  std::uint64_t emits = 0;
+  for (const auto& e : snapshot.events)
+  {
+    emits += e.emit_count;
+  }
+  REQUIRE(emits == 3);
+
+  REQUIRE(snapshot.listeners.size() == 1);
+  REQUIRE(snapshot.listeners.front().first == c.connection_id);
+  REQUIRE(snapshot.listeners.front().second.invoke_count == 2);
+  REQUIRE(!snapshot.slow_listeners.empty());
+
+  object.clearInstrumentation();
+  REQUIRE(object.instrumentationSnapshot().events.empty());
+
+  VolatilePublisher pub;
+  VolatileSubscriber sub;
+  pub.addSubscriber(&sub);
+  pub.notify(&VolatileSubscriber::ping);
+  REQUIRE(pub.notifyCount() == 1);
+  REQUIRE(pub.notifyLatency().count() == 1);
+  pub.removeSubscriber(&sub);
+}
+
+#endif // EVENTS_ENABLE_INSTRUMENTATION
+
+#if EVENTS_HAS_AWAITABLE_EVENTS
+
+struct CoTask
+{
+  struct promise_type
+  {
+    CoTask get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() {}
+  };
+};
+
+CoTask record_names(Person& person, std::vector<std::string>& names)
+{
+  // two sequential protocol steps, each awaiting the next emission
+  std::string name = co_await whenEmitted(person, &Person::nameChanged);
+  names.push_back(name);
+
+  name = co_await whenEmitted(person, &Person::nameChanged);
+  names.push_back(name);
+}
+
+CoTask await_super_event(MyClass& object, int& count)
+{
+  co_await whenEmitted(object, &MyClass::superEvent);
+  ++count;
+}
+
+void test_awaitable_event()
+{
+  Person person;
+  std::vector<std::string> names;
+
+  record_names(person, names);
+
+  person.setName("Homer");
+  person.setName("Marge");
+  person.setName("Bart"); // the coroutine has finished, nobody is listening
+  REQUIRE(names.size() == 2);
+  REQUIRE(names.front() == "Homer");
+  REQUIRE(names.back() == "Marge");
+
+  MyClass object;
+  int count = 0;
+  await_super_event(object, count);
+
+  REQUIRE(count == 0);
+  object.superEvent();
+  REQUIRE(count == 1);
+  object.superEvent();
+  REQUIRE(count == 1);
+}
+
+#endif // EVENTS_HAS_AWAITABLE_EVENTS
+
 void run()
 {
   test_invoke_relaxed();
   test_disconnect();
+  test_stale_connection_id();
+  test_bulk_disconnect();
+  test_lifetime_token();
   test_two_events();
+  test_compile_time_events();
+  test_callback();
+  test_listener_arena();
+  test_borrowed_arguments();
+  test_emit_batch();
   test_partial_args();
   test_once();
+  test_once_burst();
+  test_listener_priorities();
+  test_reentrant_emit();
+  test_concurrent_emitter();
   test_pubsub();
+  test_reentrant_notify();
+  test_parallel_notify();
+  test_emit_parallel();
   test_object();
   test_two_objects();
+  test_conflated_connection();
+  test_queued_connection();
+  test_object_hierarchy();
+  test_named_events();
+  test_event_bus();
+  test_filtered_connections();
+  test_event_journal();
+  test_signal();
+  test_timer_wheel();
+
+#if EVENTS_HAS_AWAITABLE_EVENTS
+  test_awaitable_event();
+#endif
+
+#if defined(EVENTS_ENABLE_INSTRUMENTATION)
+  test_instrumentation();
+#endif
 }
 
 int main()